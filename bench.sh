@@ -0,0 +1,28 @@
+#!/bin/bash
+set -e
+
+OUTPUT_DIR="modules"
+STANDALONE="colors registry random log profile input atlas"
+
+./compile.sh
+gcc -Wall -Werror -O2 -Isrc -Ibench -o $OUTPUT_DIR/host bench/host.c bench/mock_engine.c -ldl -lpthread -lm
+for bench in $STANDALONE; do
+  gcc -Wall -Werror -O2 -Isrc -Ibench -o $OUTPUT_DIR/$bench bench/$bench.c src/fiasco.c src/profiler.c \
+    src/png.c src/atlas.c src/snapshot.c -lm -lpthread
+done
+
+if [[ " $STANDALONE " == *" $1 "* ]]; then
+  ./$OUTPUT_DIR/$1
+elif [[ "$1" == "replay" ]]; then
+  # records with spawns and plays back without them, once plain and once with
+  # the collider on several workers; the host fails if the worlds differ
+  HOST="./$OUTPUT_DIR/host --module $OUTPUT_DIR/sample-c.dylib --frames 200"
+  PREFIX="${TMPDIR:-/tmp}/fiasco-replay-$$"
+  for flags in "" "--collide --threads 4"; do
+    $HOST $flags --burst --hold-mouse --record "$PREFIX" 5000
+    $HOST $flags --replay "$PREFIX" 5000
+  done
+  rm -f "$PREFIX"-*
+else
+  ./$OUTPUT_DIR/host --module $OUTPUT_DIR/sample-c.dylib "$@"
+fi
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fiasco.h>
+#include <png.h>
+#include <atlas.h>
+
+// Atlas packer bench, no GPU needed. With no arguments it writes random
+// sprites to a temporary directory, packs them, reads the sheets back and
+// checks every sprite's pixels and extruded edges through the UV table, then
+// compares decoding the sprites one file at a time against the sheets.
+// With `DIR OUT [SIZE [PADDING]]` it packs DIR into OUT-N.png and OUT.atlas.
+
+#define SPRITES 400
+#define SHEET_SIZE 1024
+#define PADDING 2
+#define PATH_MAX_LEN 4096
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// A pattern unique to each sprite and pixel, with flat runs to compress
+static void sprite_pixel(uint32_t sprite, uint32_t x, uint32_t y, uint8_t *out) {
+  out[0] = (uint8_t)(sprite * 37);
+  out[1] = (uint8_t)(x / 4 * 8 + sprite);
+  out[2] = (uint8_t)(y / 4 * 8);
+  out[3] = (uint8_t)(sprite >> 8 | 0x80);
+}
+
+static bool write_sprites(const char *dir, uint32_t sizes[][2]) {
+  for (uint32_t i = 0; i < SPRITES; i++) {
+    Image image;
+    sizes[i][0] = 4 + (uint32_t)(random_float() * 60);
+    sizes[i][1] = 4 + (uint32_t)(random_float() * 60);
+    if (!image_alloc(&image, sizes[i][0], sizes[i][1])) return false;
+    for (uint32_t y = 0; y < image.height; y++) {
+      for (uint32_t x = 0; x < image.width; x++) {
+        sprite_pixel(i, x, y, image.pixels + ((size_t)y * image.width + x) * 4);
+      }
+    }
+    char path[PATH_MAX_LEN];
+    snprintf(path, sizeof(path), "%s/sprite-%04u.png", dir, i);
+    bool ok = png_write(path, &image);
+    image_free(&image);
+    if (!ok) return false;
+  }
+  return true;
+}
+
+static bool check_sprite(const Atlas *atlas, const Image *sheets, uint32_t index, const uint32_t size[2]) {
+  char name[64];
+  snprintf(name, sizeof(name), "sprite-%04u.png", index);
+  const AtlasSprite *sprite = atlas_find(atlas, name);
+  if (sprite == NULL || sprite->w != size[0] || sprite->h != size[1]) {
+    printf("  %s is missing or has the wrong size\n", name);
+    return false;
+  }
+
+  // UVs must land on the sprite's pixels
+  const Image *sheet = &sheets[sprite->sheet];
+  uint32_t x0 = (uint32_t)(sprite->uv[0] * atlas->sheet_size + 0.5f);
+  uint32_t y0 = (uint32_t)(sprite->uv[1] * atlas->sheet_size + 0.5f);
+  uint32_t x1 = (uint32_t)(sprite->uv[2] * atlas->sheet_size + 0.5f);
+  uint32_t y1 = (uint32_t)(sprite->uv[3] * atlas->sheet_size + 0.5f);
+  if (x0 != sprite->x || y0 != sprite->y || x1 - x0 != sprite->w || y1 - y0 != sprite->h) {
+    printf("  %s UVs do not match its rect\n", name);
+    return false;
+  }
+
+  int pad = (int)atlas->padding;
+  for (int y = -pad; y < (int)sprite->h + pad; y++) {
+    for (int x = -pad; x < (int)sprite->w + pad; x++) {
+      // the padding repeats the nearest edge pixel
+      uint32_t sx = x < 0 ? 0 : (x >= (int)sprite->w ? sprite->w - 1 : (uint32_t)x);
+      uint32_t sy = y < 0 ? 0 : (y >= (int)sprite->h ? sprite->h - 1 : (uint32_t)y);
+      uint8_t want[4];
+      sprite_pixel(index, sx, sy, want);
+      const uint8_t *got = sheet->pixels + ((size_t)(sprite->y + y) * sheet->width + sprite->x + x) * 4;
+      if (memcmp(want, got, 4) != 0) {
+        printf("  %s differs at %d,%d\n", name, x, y);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void remove_dir(const char *dir, const char *prefix, size_t sheets) {
+  char path[PATH_MAX_LEN];
+  for (uint32_t i = 0; i < SPRITES; i++) {
+    snprintf(path, sizeof(path), "%s/sprite-%04u.png", dir, i);
+    remove(path);
+  }
+  for (size_t s = 0; s < sheets; s++) {
+    snprintf(path, sizeof(path), "%s-%zu.png", prefix, s);
+    remove(path);
+  }
+  snprintf(path, sizeof(path), "%s.atlas", prefix);
+  remove(path);
+  rmdir(dir);
+}
+
+static int self_test() {
+  Image thumb;
+  if (!png_read("assets/thumb.png", &thumb)) {
+    printf("could not decode assets/thumb.png\n");
+    return 1;
+  }
+  printf("assets/thumb.png decodes to %ux%u\n", thumb.width, thumb.height);
+  image_free(&thumb);
+
+  char dir[] = "/tmp/fiasco-atlas-XXXXXX";
+  if (mkdtemp(dir) == NULL) return 1;
+  char sprites[256], prefix[256], table[256];
+  snprintf(sprites, sizeof(sprites), "%s/sprites", dir);
+  snprintf(prefix, sizeof(prefix), "%s/sheet", dir);
+  snprintf(table, sizeof(table), "%s/sheet.atlas", dir);
+  mkdir(sprites, 0700);
+
+  static uint32_t sizes[SPRITES][2];
+  random_seed(24);
+  bool ok = write_sprites(sprites, sizes);
+
+  AtlasStats stats;
+  uint64_t start = now_ns();
+  ok = ok && atlas_build(sprites, prefix, SHEET_SIZE, PADDING, &stats);
+  double build_ms = (double)(now_ns() - start) / 1e6;
+
+  Atlas atlas;
+  ok = ok && atlas_load(&atlas, table);
+  if (!ok) {
+    printf("packing failed\n");
+    return 1;
+  }
+
+  // what the runtime pays: N sprite files against the sheets
+  start = now_ns();
+  for (uint32_t i = 0; i < SPRITES; i++) {
+    char path[PATH_MAX_LEN];
+    snprintf(path, sizeof(path), "%s/sprite-%04u.png", sprites, i);
+    Image image;
+    ok = png_read(path, &image) && ok;
+    image_free(&image);
+  }
+  double files_ms = (double)(now_ns() - start) / 1e6;
+
+  Image *sheets = (Image*)calloc(atlas.sheets_len, sizeof(Image));
+  start = now_ns();
+  for (size_t s = 0; s < atlas.sheets_len; s++) {
+    char path[PATH_MAX_LEN];
+    snprintf(path, sizeof(path), "%s/%s", dir, atlas.sheets[s]);
+    ok = png_read(path, &sheets[s]) && ok;
+  }
+  double sheets_ms = (double)(now_ns() - start) / 1e6;
+
+  for (uint32_t i = 0; ok && i < SPRITES; i++) ok = check_sprite(&atlas, sheets, i, sizes[i]);
+
+  double occupancy = (double)stats.sprite_pixels / ((double)stats.sheets * SHEET_SIZE * SHEET_SIZE);
+  printf("%zu sprites into %zu %ux%u sheets, %.1f%% occupied, built in %.1f ms\n", stats.sprites, stats.sheets,
+         SHEET_SIZE, SHEET_SIZE, occupancy * 100, build_ms);
+  printf("decode: %d files %.1f ms  %zu sheets %.1f ms\n", SPRITES, files_ms, atlas.sheets_len, sheets_ms);
+  printf("pixels, UVs and padding %s\n", ok ? "match" : "DO NOT MATCH");
+
+  for (size_t s = 0; s < atlas.sheets_len; s++) image_free(&sheets[s]);
+  free(sheets);
+  size_t sheet_count = atlas.sheets_len;
+  atlas_free(&atlas);
+  remove_dir(sprites, prefix, sheet_count);
+  rmdir(dir);
+  return ok && stats.skipped == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) return self_test();
+
+  uint32_t size = argc > 3 ? (uint32_t)atoi(argv[3]) : 4096;
+  uint32_t padding = argc > 4 ? (uint32_t)atoi(argv[4]) : PADDING;
+  AtlasStats stats;
+  if (!atlas_build(argv[1], argv[2], size, padding, &stats)) return 1;
+  printf("%zu sprites into %zu sheets, %zu skipped\n", stats.sprites, stats.sheets, stats.skipped);
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <fiasco.h>
+
+// Color conversion bench: sweeps the whole 8-bit RGB cube through the batch
+// APIs, checks them against the scalar versions, then times both.
+
+#define CHANNEL_TOLERANCE 1e-5f
+#define HUE_TOLERANCE 1e-3f
+#define PLANE (256 * 256)
+#define BENCH_LEN 1000000
+#define BENCH_ROUNDS 20
+
+static const char *levels[] = {"scalar", "sse2", "avx2"};
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static float hue_error(float a, float b) {
+  float d = fabsf(a - b);
+  return fminf(d, 360.0f - d);
+}
+
+static float rgb_error(Color a, Color b) {
+  return fmaxf(fabsf(a.r - b.r), fmaxf(fabsf(a.g - b.g), fabsf(a.b - b.b)));
+}
+
+static bool sweep_cube() {
+  Color *rgb = malloc(PLANE * sizeof(Color));
+  HSVA *hsv = malloc(PLANE * sizeof(HSVA));
+  HSVA *hsv_ref = malloc(PLANE * sizeof(HSVA));
+  Color *back = malloc(PLANE * sizeof(Color));
+
+  float max_h = 0, max_sv = 0, max_rgb = 0, max_round_trip = 0;
+
+  for (int r = 0; r < 256; r++) {
+    for (int i = 0; i < PLANE; i++) {
+      rgb[i] = (Color){r / 255.0f, (i >> 8) / 255.0f, (i & 0xff) / 255.0f, 1.0f};
+      hsv_ref[i] = rgb_to_hsv(rgb[i]);
+    }
+
+    rgb_to_hsv_batch(rgb, hsv, PLANE);
+    hsv_to_rgb_batch(hsv_ref, back, PLANE);
+
+    for (int i = 0; i < PLANE; i++) {
+      max_h = fmaxf(max_h, hue_error(hsv[i].h, hsv_ref[i].h));
+      max_sv = fmaxf(max_sv, fmaxf(fabsf(hsv[i].s - hsv_ref[i].s), fabsf(hsv[i].v - hsv_ref[i].v)));
+      max_rgb = fmaxf(max_rgb, rgb_error(back[i], hsv_to_rgb(hsv_ref[i])));
+    }
+
+    hsv_to_rgb_batch(hsv, back, PLANE);
+    for (int i = 0; i < PLANE; i++) {
+      max_round_trip = fmaxf(max_round_trip, rgb_error(back[i], rgb[i]));
+    }
+  }
+
+  free(rgb);
+  free(hsv);
+  free(hsv_ref);
+  free(back);
+
+  bool ok = max_h <= HUE_TOLERANCE && max_sv <= CHANNEL_TOLERANCE &&
+            max_rgb <= CHANNEL_TOLERANCE && max_round_trip <= CHANNEL_TOLERANCE;
+  printf("  cube sweep: hue %.2e  s/v %.2e  rgb %.2e  round trip %.2e  %s\n",
+         max_h, max_sv, max_rgb, max_round_trip, ok ? "ok" : "OUT OF BOUNDS");
+  return ok;
+}
+
+static volatile float sink;
+
+static void bench() {
+  Color *rgb = malloc(BENCH_LEN * sizeof(Color));
+  HSVA *hsv = malloc(BENCH_LEN * sizeof(HSVA));
+  for (int i = 0; i < BENCH_LEN; i++) {
+    rgb[i] = (Color){random_float(), random_float(), random_float(), 1.0f};
+  }
+
+  uint64_t start = now_ns();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    for (int i = 0; i < BENCH_LEN; i++) {
+      hsv[i] = rgb_to_hsv(rgb[i]);
+      rgb[i] = hsv_to_rgb(hsv[i]);
+    }
+  }
+  double scalar_ns = (double)(now_ns() - start) / ((double)BENCH_LEN * BENCH_ROUNDS);
+
+  start = now_ns();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    rgb_to_hsv_batch(rgb, hsv, BENCH_LEN);
+    hsv_to_rgb_batch(hsv, rgb, BENCH_LEN);
+  }
+  double batch_ns = (double)(now_ns() - start) / ((double)BENCH_LEN * BENCH_ROUNDS);
+
+  sink = rgb[BENCH_LEN / 2].r;
+  printf("  round trip: scalar %.2f ns/color  batch %.2f ns/color  (%.1fx)\n", scalar_ns, batch_ns, scalar_ns / batch_ns);
+
+  free(rgb);
+  free(hsv);
+}
+
+int main(int argc, char **argv) {
+  int failed = 0;
+
+  for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      // simd_level() caches its first answer, so each level gets a fresh process
+      setenv("FIASCO_SIMD", levels[i], 1);
+      printf("%s (running %s)\n", levels[i], levels[simd_level()]);
+      bool ok = sweep_cube();
+      bench();
+      exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+  }
+
+  return failed;
+}
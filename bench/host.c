@@ -0,0 +1,1106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <mock_engine.h>
+#include <profiler.h>
+#include <autosave.h>
+#include <replay.h>
+#include <textures.h>
+
+// Headless host: loads the module against the mock engine, grows the thumb
+// population to each requested size and times every system per frame.
+
+#define MAX_SYSTEMS 32
+#define MAX_ARGS 16
+#define TARGET_ENTITY_FRAMES 20000000.0
+#define MIN_FRAMES 3
+// mirrors THUMB_BURST in game.c
+#define MODULE_BURST 1000
+// pool size the host asks for unless --pool is given, small so plain runs
+// measure almost only the thumbs the host grows
+#define DEFAULT_POOL "64"
+// with --collide the world grows so each thumb gets this much room
+#define COLLIDE_AREA_PER_THUMB (100.0f * 100.0f)
+#define MAX_FRAMES 600
+// frames the host waits for the spawner, which waits on the texture loads
+#define MAX_STARTUP_FRAMES 100
+
+const char *default_module = "modules/sample-c.dylib";
+const size_t default_sizes[] = {1000, 100000, 10000000};
+
+// MODULE
+
+#define MODULE_PROC(name) __typeof__(name) *name
+
+typedef struct {
+  void *handle;
+  MODULE_PROC(init);
+  MODULE_PROC(deinit);
+  MODULE_PROC(load_engine_proc_addrs);
+  MODULE_PROC(set_component_id);
+  MODULE_PROC(component_string_id);
+  MODULE_PROC(component_size);
+  MODULE_PROC(systems_len);
+  MODULE_PROC(system_is_once);
+  MODULE_PROC(system_name);
+  MODULE_PROC(system_fn);
+  MODULE_PROC(system_args_len);
+  MODULE_PROC(system_arg_type);
+  MODULE_PROC(system_arg_component);
+  MODULE_PROC(system_arg_event);
+  MODULE_PROC(system_query_args_len);
+  MODULE_PROC(system_query_arg_component);
+  MODULE_PROC(system_query_arg_type);
+  MODULE_PROC(resource_serialize);
+  MODULE_PROC(resource_deserialize);
+} Module;
+
+#define LOAD_PROC(module, name) \
+  if ((module->name = dlsym(module->handle, #name)) == NULL) { \
+    printf("module is missing export %s\n", #name); \
+    return false; \
+  }
+
+static bool module_open(Module *module, const char *path) {
+  module->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (module->handle == NULL) {
+    printf("failed to load %s: %s\n", path, dlerror());
+    return false;
+  }
+
+  LOAD_PROC(module, init);
+  LOAD_PROC(module, deinit);
+  LOAD_PROC(module, load_engine_proc_addrs);
+  LOAD_PROC(module, set_component_id);
+  LOAD_PROC(module, component_string_id);
+  LOAD_PROC(module, component_size);
+  LOAD_PROC(module, systems_len);
+  LOAD_PROC(module, system_is_once);
+  LOAD_PROC(module, system_name);
+  LOAD_PROC(module, system_fn);
+  LOAD_PROC(module, system_args_len);
+  LOAD_PROC(module, system_arg_type);
+  LOAD_PROC(module, system_arg_component);
+  LOAD_PROC(module, system_arg_event);
+  LOAD_PROC(module, system_query_args_len);
+  LOAD_PROC(module, system_query_arg_component);
+  LOAD_PROC(module, system_query_arg_type);
+  LOAD_PROC(module, resource_serialize);
+  LOAD_PROC(module, resource_deserialize);
+  return true;
+}
+
+// ENGINE STATE
+
+static uint8_t input_state[256];
+static float frame_constants[2] = {1.0f / 60.0f, 60.0f};
+static float aspect[2] = {1920.0f, 1080.0f};
+static uint8_t event_writer_dummy;
+
+typedef struct {
+  const char *string_id;
+  size_t size;
+  void *resource;
+} EngineComponent;
+
+static EngineComponent engine_components[] = {
+  {"void_public::colors::Color", sizeof(Color), NULL},
+  {"void_public::Camera", sizeof(Camera), NULL},
+  {"void_public::Transform", sizeof(Transform), NULL},
+  {"void_public::input::InputState", sizeof(input_state), input_state},
+  {"void_public::graphics::TextureRender", sizeof(TextureRender), NULL},
+  {"void_public::graphics::ColorRender", sizeof(ColorRender), NULL},
+  {"void_public::graphics::TextRender", sizeof(TextRender), NULL},
+  {"void_public::graphics::CircleRender", sizeof(CircleRender), NULL},
+  {"void_public::FrameConstants", sizeof(frame_constants), frame_constants},
+  {"void_public::Aspect", sizeof(aspect), aspect},
+  {"void_public::EntityId", sizeof(EntityId), NULL},
+  {"game_asset::ecs_module::GpuInterface", 0, NULL},
+  {"game_asset::ecs_module::MaterialManager", 0, NULL},
+  {"gpu_web::GpuResource", 0, NULL},
+  {"gpu_web::gpu_config::GpuConfig", 0, NULL},
+};
+
+#define ENGINE_COMPONENTS_LEN (sizeof(engine_components) / sizeof(engine_components[0]))
+
+static void* engine_resource(const char *string_id) {
+  if (string_id == NULL) return NULL;
+  if (strcmp(string_id, "game_asset::ecs_module::GpuInterface") == 0) return mock_gpu_interface();
+  for (size_t i = 0; i < ENGINE_COMPONENTS_LEN; i++) {
+    if (strcmp(engine_components[i].string_id, string_id) == 0) return engine_components[i].resource;
+  }
+  return NULL;
+}
+
+static void register_components(Module *module) {
+  for (size_t i = 0; i < ENGINE_COMPONENTS_LEN; i++) {
+    mock_register_component(engine_components[i].string_id, engine_components[i].size);
+  }
+
+  char *string_id;
+  for (size_t i = 0; (string_id = module->component_string_id(i)) != NULL; i++) {
+    mock_register_component(string_id, module->component_size(string_id));
+  }
+
+  for (ComponentId id = 1; id < mock_components_len(); id++) {
+    module->set_component_id((char*)mock_component_string_id(id), id);
+  }
+}
+
+// SYSTEMS
+
+typedef struct {
+  char *name;
+  system_func fn;
+  bool once;
+  size_t args_len;
+  const void *args[MAX_ARGS];
+  MockQuery *queries[MAX_ARGS];
+  uint64_t ns;
+  uint64_t max_ns; // slowest single call
+} System;
+
+static System systems[MAX_SYSTEMS];
+static size_t systems_count = 0;
+
+static bool build_systems(Module *module) {
+  systems_count = module->systems_len();
+  if (systems_count > MAX_SYSTEMS) {
+    printf("module declares %zu systems, host supports %d\n", systems_count, MAX_SYSTEMS);
+    return false;
+  }
+
+  for (size_t s = 0; s < systems_count; s++) {
+    System *system = &systems[s];
+    memset(system, 0, sizeof(System));
+    system->name = module->system_name(s);
+    system->fn = module->system_fn(s);
+    system->once = module->system_is_once(s);
+    system->args_len = module->system_args_len(s);
+
+    if (system->args_len > MAX_ARGS) {
+      printf("system %s declares %zu args, host supports %d\n", system->name, system->args_len, MAX_ARGS);
+      return false;
+    }
+
+    for (size_t a = 0; a < system->args_len; a++) {
+      ArgType type = module->system_arg_type(s, a);
+
+      if (type == Query) {
+        size_t len = module->system_query_args_len(s, a);
+        ComponentId ids[MOCK_MAX_QUERY];
+        if (len > MOCK_MAX_QUERY) {
+          printf("system %s query %zu has %zu components, host supports %d\n", system->name, a, len, MOCK_MAX_QUERY);
+          return false;
+        }
+        for (size_t q = 0; q < len; q++) {
+          ids[q] = mock_component_id(module->system_query_arg_component(s, a, q));
+        }
+        system->queries[a] = mock_query_new(ids, len);
+        system->args[a] = system->queries[a];
+      } else if (type == DataAccessRef || type == DataAccessMut) {
+        system->args[a] = engine_resource(module->system_arg_component(s, a));
+      } else {
+        system->args[a] = &event_writer_dummy;
+      }
+    }
+  }
+
+  return true;
+}
+
+static void free_systems() {
+  for (size_t s = 0; s < systems_count; s++) {
+    for (size_t a = 0; a < systems[s].args_len; a++) mock_query_free(systems[s].queries[a]);
+  }
+  systems_count = 0;
+}
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool run_frame(bool first) {
+  for (size_t s = 0; s < systems_count; s++) {
+    System *system = &systems[s];
+    if (system->once && !first) continue;
+
+    uint64_t start = now_ns();
+    int code = system->fn(system->args);
+    uint64_t ns = now_ns() - start;
+    system->ns += ns;
+    if (ns > system->max_ns) system->max_ns = ns;
+
+    if (code != 0) {
+      printf("system %s returned %d\n", system->name, code);
+      return false;
+    }
+  }
+
+  mock_next_frame();
+  return true;
+}
+
+// POPULATION
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static float host_random(float min, float max) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return min + (max - min) * (float)(rng_state >> 40) / (float)(1 << 24);
+}
+
+// Clones the visible thumbs the spawner made, so the host never needs the
+// module's Thumb layout. Hidden pool thumbs count towards the target as-is.
+static size_t grow_thumbs(MockQuery *thumbs, size_t target) {
+  ComponentId transform_id = mock_component_id("void_public::Transform");
+  ComponentId texture_render_id = mock_component_id("void_public::graphics::TextureRender");
+
+  size_t existing = 0;
+  size_t seeds_len = 0;
+  EntityId seeds[64];
+  EntityId entity;
+  while ((entity = mock_query_entity(thumbs, existing)) != 0) {
+    const TextureRender *texture_render = mock_entity_component(entity, texture_render_id);
+    if (seeds_len < 64 && texture_render->visible) seeds[seeds_len++] = entity;
+    existing++;
+  }
+  if (seeds_len == 0) return 0;
+
+  float half_w = aspect[0] / 2;
+  float half_h = aspect[1] / 2;
+
+  for (size_t i = existing; i < target; i++) {
+    EntityId clone = mock_clone_entity(seeds[i % seeds_len]);
+    Transform *transform = mock_entity_component(clone, transform_id);
+    transform->position.x = host_random(-half_w, half_w);
+    transform->position.y = host_random(-half_h, half_h);
+  }
+
+  return target > existing ? target : existing;
+}
+
+// FFI PATHS
+
+static volatile float ffi_sink;
+
+static int sum_position(const void **ptrs, void *user_data) {
+  *(float*)user_data += ((const Transform*)ptrs[1])->position.x;
+  return 0;
+}
+
+static void compare_ffi_paths(MockQuery *thumbs, size_t count) {
+  Engine engine;
+  engine.query_get = mock_get_proc("query_get");
+  engine.query_len = mock_get_proc("query_len");
+  engine.query_for_each = mock_get_proc("query_for_each");
+
+  float sum = 0;
+  uint64_t start = now_ns();
+  size_t len = engine.query_len(thumbs);
+  for (size_t i = 0; i < len; i++) {
+    const void *ptrs[2];
+    if (engine.query_get(thumbs, i, ptrs) == 0) sum_position(ptrs, &sum);
+  }
+  uint64_t get_ns = now_ns() - start;
+
+  start = now_ns();
+  engine.query_for_each(thumbs, sum_position, &sum);
+  uint64_t for_each_ns = now_ns() - start;
+
+  printf("%-24s %12s %12.2f\n", "ffi query_get", "", (double)get_ns / count);
+  printf("%-24s %12s %12.2f\n", "ffi query_for_each", "", (double)for_each_ns / count);
+  ffi_sink = sum;
+}
+
+// SNAPSHOT
+
+static size_t file_write(void *file, void *buf, size_t len) {
+  return fwrite(buf, 1, len, (FILE*)file);
+}
+
+static size_t file_read(void *file, void *buf, size_t len) {
+  return fread(buf, 1, len, (FILE*)file);
+}
+
+static void hash_bytes(uint64_t *hash, const void *data, size_t len) {
+  const uint8_t *bytes = data;
+  for (size_t b = 0; b < len; b++) {
+    *hash = (*hash ^ bytes[b]) * 0x100000001b3ull;
+  }
+}
+
+// FNV-1a over every thumb's Thumb, Transform and Color bytes and whether it
+// is visible
+static uint64_t hash_thumbs(MockQuery *thumbs) {
+  ComponentId ids[3] = {
+    mock_component_id("Thumb"), mock_component_id("void_public::Transform"),
+    mock_component_id("void_public::colors::Color")
+  };
+  ComponentId texture_render_id = mock_component_id("void_public::graphics::TextureRender");
+  uint64_t hash = 0xcbf29ce484222325ull;
+  EntityId entity;
+  for (size_t i = 0; (entity = mock_query_entity(thumbs, i)) != 0; i++) {
+    for (size_t c = 0; c < 3; c++) {
+      hash_bytes(&hash, mock_entity_component(entity, ids[c]), mock_component_size(ids[c]));
+    }
+    const TextureRender *render = mock_entity_component(entity, texture_render_id);
+    hash_bytes(&hash, &render->visible, sizeof(render->visible));
+  }
+  return hash;
+}
+
+// Everything hash_thumbs covers, so a restore that misses any of it shows
+static void scramble_thumbs(MockQuery *thumbs) {
+  ComponentId thumb_id = mock_component_id("Thumb");
+  ComponentId transform_id = mock_component_id("void_public::Transform");
+  ComponentId color_id = mock_component_id("void_public::colors::Color");
+  ComponentId texture_render_id = mock_component_id("void_public::graphics::TextureRender");
+  EntityId entity;
+  for (size_t i = 0; (entity = mock_query_entity(thumbs, i)) != 0; i++) {
+    memset(mock_entity_component(entity, thumb_id), 0, mock_component_size(thumb_id));
+    Transform *transform = mock_entity_component(entity, transform_id);
+    transform->position.x = host_random(-aspect[0], aspect[0]);
+    transform->position.y = host_random(-aspect[1], aspect[1]);
+    Color *color = mock_entity_component(entity, color_id);
+    *color = (Color){host_random(0, 1), host_random(0, 1), host_random(0, 1), 1};
+    TextureRender *render = mock_entity_component(entity, texture_render_id);
+    render->visible = !render->visible;
+  }
+}
+
+// F5 captures the world, the module saves it to a file and loads it back over
+// scrambled thumbs; the next frame must put every thumb back exactly
+static bool round_trip_snapshot(Module *module, MockQuery *thumbs) {
+  memset(input_state, 0, sizeof(input_state));
+  input_state[F5] = 0b01;
+  uint64_t start = now_ns();
+  if (!run_frame(false)) return false;
+  uint64_t capture_ns = now_ns() - start;
+  input_state[F5] = 0;
+  uint64_t expected = hash_thumbs(thumbs);
+
+  FILE *file = tmpfile();
+  if (file == NULL) {
+    printf("could not open a snapshot file\n");
+    return false;
+  }
+
+  start = now_ns();
+  int code = module->resource_serialize("GameState", NULL, file, file_write);
+  fflush(file);
+  uint64_t save_ns = now_ns() - start;
+  double mb = ftell(file) / 1e6;
+
+  scramble_thumbs(thumbs);
+  rewind(file);
+  start = now_ns();
+  code |= module->resource_deserialize("GameState", NULL, file, file_read);
+  uint64_t load_ns = now_ns() - start;
+  fclose(file);
+
+  start = now_ns();
+  if (code != 0 || !run_frame(false)) {
+    printf("snapshot round trip failed\n");
+    return false;
+  }
+  uint64_t apply_ns = now_ns() - start;
+
+  printf("%-24s %12.3f ms  frame with the F5 capture\n", "snapshot capture", capture_ns / 1e6);
+  printf("%-24s %12.3f ms  %.1f MB, %.0f MB/s\n", "snapshot save", save_ns / 1e6, mb, mb / (save_ns / 1e9));
+  printf("%-24s %12.3f ms  %.0f MB/s\n", "snapshot load", load_ns / 1e6, mb / (load_ns / 1e9));
+  printf("%-24s %12.3f ms  frame that writes it back\n", "snapshot apply", apply_ns / 1e6);
+
+  if (hash_thumbs(thumbs) != expected) {
+    printf("restored thumbs differ from the saved ones\n");
+    return false;
+  }
+  return true;
+}
+
+// AUTOSAVE
+
+static System* find_system(const char *name) {
+  for (size_t s = 0; s < systems_count; s++) {
+    if (strcmp(systems[s].name, name) == 0) return &systems[s];
+  }
+  return NULL;
+}
+
+// Worst frame cost of the slice capture, then the world is frozen (delta 0)
+// until two whole autosaves have finished, scrambled, and F9 must bring it
+// back exactly
+static bool verify_autosave(Module *module, MockQuery *thumbs) {
+  __typeof__(autosave_stats) *stats = dlsym(module->handle, "autosave_stats");
+  System *snapshot = find_system("game_snapshot");
+  if (stats == NULL || snapshot == NULL) {
+    printf("module has no autosave\n");
+    return false;
+  }
+
+  AutosaveStats before = stats();
+  printf("%-24s %12.3f ms  worst frame in game_snapshot, %llu saves so far\n", "autosave capture",
+         snapshot->max_ns / 1e6, (unsigned long long)before.saves);
+
+  float delta = frame_constants[0];
+  frame_constants[0] = 0;
+  memset(input_state, 0, sizeof(input_state));
+  for (int i = 0; i < 2; i++) {
+    if (!run_frame(false)) return false;
+  }
+  uint64_t expected = hash_thumbs(thumbs);
+
+  // one capture may have started before the freeze; only the next is whole
+  uint64_t calls = 0;
+  uint64_t start = now_ns();
+  for (uint64_t target = stats().saves + 2; stats().saves < target; calls++) {
+    if (snapshot->fn(snapshot->args) != 0) return false;
+  }
+  uint64_t ns = now_ns() - start;
+  AutosaveStats after = stats();
+  printf("%-24s %12.3f ms  %llu frames a save, last %.1f MB -> %.1f MB in %.1f ms on the worker\n", "autosave cycle",
+         ns / 2 / 1e6, (unsigned long long)(calls / 2), after.raw_bytes / 1e6, after.written_bytes / 1e6, after.ms);
+  // the second whole save has the first as its base, so it must be a delta
+  if (after.fulls >= after.saves) {
+    printf("autosave wrote %llu full saves and no deltas\n", (unsigned long long)after.fulls);
+    return false;
+  }
+
+  scramble_thumbs(thumbs);
+  input_state[F9] = 0b01;
+  bool ok = run_frame(false);
+  input_state[F9] = 0;
+  frame_constants[0] = delta;
+  if (!ok) return false;
+
+  if (hash_thumbs(thumbs) != expected) {
+    printf("thumbs loaded from the autosave differ from the saved ones\n");
+    return false;
+  }
+  return true;
+}
+
+// REPLAY
+
+// The recording run stores the world's hash after the timed frames. The
+// replaying run gets only the recorded input and seed, and must end on it.
+static bool check_replay(Module *module, MockQuery *thumbs, const char *input_path, bool replaying) {
+  __typeof__(replay_frames) *frames = dlsym(module->handle, "replay_frames");
+  if (frames == NULL) {
+    printf("module has no input replay\n");
+    return false;
+  }
+
+  char path[1024];
+  snprintf(path, sizeof(path), "%s.hash", input_path);
+  uint64_t hash = hash_thumbs(thumbs);
+  if (!replaying) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+      printf("could not write %s\n", path);
+      return false;
+    }
+    fprintf(file, "%016llx\n", (unsigned long long)hash);
+    fclose(file);
+    printf("%-24s %12llu frames  world %016llx\n", "input recorded", (unsigned long long)frames(),
+           (unsigned long long)hash);
+    return true;
+  }
+
+  unsigned long long expected = 0;
+  long bytes = 0;
+  FILE *file = fopen(path, "r");
+  bool found = file != NULL && fscanf(file, "%llx", &expected) == 1;
+  if (file != NULL) fclose(file);
+  file = fopen(input_path, "rb");
+  if (file != NULL) {
+    fseek(file, 0, SEEK_END);
+    bytes = ftell(file);
+    fclose(file);
+  }
+  if (!found) {
+    printf("no recorded world hash in %s\n", path);
+    return false;
+  }
+
+  printf("%-24s %12llu frames  world %016llx, %ld bytes of input\n", "input replayed",
+         (unsigned long long)frames(), (unsigned long long)hash, bytes);
+  if (hash != expected) {
+    printf("replayed world differs from the recorded one (%016llx)\n", expected);
+    return false;
+  }
+  return true;
+}
+
+// TEXTURES
+
+static char texture_dir[64];
+
+// Writes `count` 16x16 PNG headers, which is all the mock reads, and a
+// manifest listing them. Returns the manifest path.
+static const char* write_texture_manifest(size_t count) {
+  static char manifest[128];
+  strcpy(texture_dir, "/tmp/fiasco-textures-XXXXXX");
+  if (mkdtemp(texture_dir) == NULL) return NULL;
+
+  snprintf(manifest, sizeof(manifest), "%s/textures.txt", texture_dir);
+  FILE *list = fopen(manifest, "w");
+  if (list == NULL) return NULL;
+  const uint8_t png[24] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n', 0, 0, 0, 13, 'I', 'H', 'D', 'R', 0, 0, 0, 16, 0, 0, 0, 16};
+  for (size_t i = 0; i < count; i++) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/sprite-%zu.png", texture_dir, i);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) break;
+    fwrite(png, 1, sizeof(png), file);
+    fclose(file);
+    fprintf(list, "sprite-%zu.png\n", i);
+  }
+  fclose(list);
+  return manifest;
+}
+
+static void remove_texture_manifest(size_t count) {
+  char path[128];
+  for (size_t i = 0; i < count; i++) {
+    snprintf(path, sizeof(path), "%s/sprite-%zu.png", texture_dir, i);
+    remove(path);
+  }
+  snprintf(path, sizeof(path), "%s/textures.txt", texture_dir);
+  remove(path);
+  rmdir(texture_dir);
+}
+
+// The module's texture loads, or NULL when it has none
+static TextureCache* module_textures(Module *module) {
+  return (TextureCache*)dlsym(module->handle, "texture_cache");
+}
+
+// RUN
+
+typedef struct {
+  const char *module_path;
+  size_t frames;
+  size_t threads;
+  bool scaling;
+  bool hold_mouse;
+  bool burst;
+  bool collide;
+  bool schedule;
+  bool verbose;
+  const char *trace;
+  bool ffi;
+  double ffi_budget;
+  bool snapshot;
+  const char *warm_start;
+  const char *autosave;
+  const char *record;
+  const char *replay;
+  size_t textures;
+} Options;
+
+static void silence_stdout(bool silence, int *saved) {
+  fflush(stdout);
+  if (silence) {
+    *saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+  } else if (*saved >= 0) {
+    dup2(*saved, STDOUT_FILENO);
+    close(*saved);
+    *saved = -1;
+  }
+}
+
+// Engine calls the module made in the last frame, from its FFI accounting.
+// Fails when they exceed `budget` calls per thumb, if one is given.
+static bool report_engine_calls(Module *module, size_t count, double budget) {
+  __typeof__(ffi_last_frame) *last_frame = dlsym(module->handle, "ffi_last_frame");
+  if (last_frame == NULL) {
+    printf("module has no FFI accounting\n");
+    return false;
+  }
+
+  FfiStat stats[64];
+  size_t len = last_frame(stats, 64);
+  uint64_t calls = 0;
+  for (size_t i = 0; i < len; i++) calls += stats[i].calls;
+
+  printf("%-24s %12llu %12.2f  per thumb\n", "engine calls/frame", (unsigned long long)calls, (double)calls / count);
+  for (size_t i = 0; i < len; i++) {
+    printf("  %-44s %10llu calls %12.1f ns\n", stats[i].name, (unsigned long long)stats[i].calls, stats[i].ns);
+  }
+
+  if (budget > 0 && (double)calls / count > budget) {
+    printf("engine calls per thumb %.2f exceed the budget of %.2f\n", (double)calls / count, budget);
+    return false;
+  }
+  return true;
+}
+
+static int run_size(const Options *options, size_t target) {
+  Module module;
+  int saved = -1;
+
+  // constant density keeps neighbours per thumb, and so collision cost per
+  // thumb, independent of the population
+  if (options->collide) {
+    float width = sqrtf(target * COLLIDE_AREA_PER_THUMB * 16.0f / 9.0f);
+    if (width > aspect[0]) {
+      aspect[0] = width;
+      aspect[1] = width * 9.0f / 16.0f;
+    }
+  }
+
+  if (options->autosave != NULL) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s-%zu.autosave", options->autosave, target);
+    setenv("FIASCO_AUTOSAVE", path, 1);
+    setenv("FIASCO_AUTOSAVE_INTERVAL", "0", 0);
+  }
+
+  char input_path[1024] = "";
+  if (options->record != NULL || options->replay != NULL) {
+    bool replaying = options->replay != NULL;
+    snprintf(input_path, sizeof(input_path), "%s-%zu.input", replaying ? options->replay : options->record, target);
+    setenv(replaying ? "FIASCO_REPLAY" : "FIASCO_RECORD", input_path, 1);
+  }
+
+  if (options->warm_start != NULL) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s-%zu.snap", options->warm_start, target);
+    setenv("FIASCO_WARM_START", path, 1);
+  }
+
+  // each run is its own process, so each gets its own trace file
+  if (options->trace != NULL) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s-%zu.json", options->trace, target);
+    setenv("FIASCO_TRACE", path, 1);
+  }
+
+  if (!options->verbose) silence_stdout(true, &saved);
+  bool loaded = module_open(&module, options->module_path);
+  if (loaded) {
+    module.load_engine_proc_addrs(mock_get_proc);
+    register_components(&module);
+    module.init();
+    loaded = build_systems(&module);
+  }
+  if (!options->verbose) silence_stdout(false, &saved);
+  if (!loaded) return 1;
+
+  mock_reset();
+  mock_set_threads(options->threads);
+
+  ComponentId thumb_ids[2] = {mock_component_id("Thumb"), mock_component_id("void_public::Transform")};
+  MockQuery *thumbs = mock_query_new(thumb_ids, 2);
+
+  // startup runs until the spawner has made the thumbs, which waits for their
+  // texture to load
+  uint64_t startup_ns = now_ns();
+  size_t startup_frames = 0;
+  do {
+    if (!run_frame(startup_frames == 0)) return 1;
+    startup_frames++;
+  } while (mock_query_entity(thumbs, 0) == 0 && startup_frames < MAX_STARTUP_FRAMES);
+  startup_ns = now_ns() - startup_ns;
+
+  // the rest of the manifest may still be loading; it must not hold the thumbs up
+  TextureCache *textures = module_textures(&module);
+  size_t texture_frames = startup_frames;
+  while (textures != NULL && textures->pending_len > 0 && texture_frames < MAX_STARTUP_FRAMES) {
+    if (!run_frame(false)) return 1;
+    texture_frames++;
+  }
+
+  size_t count = grow_thumbs(thumbs, target);
+  if (count == 0) {
+    printf("spawner produced no thumbs\n");
+    return 1;
+  }
+
+  size_t frames = options->frames;
+  if (frames == 0) {
+    frames = (size_t)(TARGET_ENTITY_FRAMES / count);
+    if (frames < MIN_FRAMES) frames = MIN_FRAMES;
+    if (frames > MAX_FRAMES) frames = MAX_FRAMES;
+  }
+
+  // warm-up frame, untimed
+  if (!run_frame(false)) return 1;
+  for (size_t s = 0; s < systems_count; s++) {
+    systems[s].ns = 0;
+    systems[s].max_ns = 0;
+  }
+
+  // left button held in the middle of the screen: controller spawns every frame
+  if (options->hold_mouse) {
+    float cursor[2] = {aspect[0] / 2, aspect[1] / 2};
+    memcpy(input_state + CURSOR_OFFSET, cursor, sizeof(cursor));
+    input_state[MOUSE_OFFSET] = 0b11;
+  }
+  if (options->burst) {
+    input_state[Space] = 0b11;
+  }
+  size_t entities_before = mock_entity_count();
+
+  uint64_t start = now_ns();
+  for (size_t f = 0; f < frames; f++) {
+    if (!run_frame(false)) return 1;
+  }
+  uint64_t total = now_ns() - start;
+
+  printf("== %zu thumbs, %zu entities, %zu frames, %zu threads ==\n", count, mock_entity_count(), frames, mock_threads());
+  printf("%-24s %12s %12s\n", "system", "ms/frame", "ns/entity");
+  for (size_t s = 0; s < systems_count; s++) {
+    if (systems[s].once) continue;
+    double per_frame = (double)systems[s].ns / frames;
+    printf("%-24s %12.3f %12.2f\n", systems[s].name, per_frame / 1e6, per_frame / count);
+  }
+  printf("%-24s %12.3f %12.2f  (%.1f fps)\n", "frame", (double)total / frames / 1e6, (double)total / frames / count, frames * 1e9 / total);
+  printf("%-24s %12.3f ms  first %zu frames, until the spawner ran\n", "startup", startup_ns / 1e6, startup_frames);
+  if (options->textures > 0 && textures != NULL) {
+    printf("%-24s %12zu        %zu failed, all settled after %zu frames\n", "textures", textures->len,
+           textures->failed, texture_frames);
+  }
+
+  // spawns come out of the module's thumb pool, so the world should not grow;
+  // their cost is whatever controller and flush_commands spend on them
+  size_t spawned = frames * ((options->hold_mouse ? 1 : 0) + (options->burst ? MODULE_BURST : 0));
+  uint64_t spawn_ns = 0;
+  for (size_t s = 0; s < systems_count && spawned > 0; s++) {
+    if (strcmp(systems[s].name, "controller") == 0 || strcmp(systems[s].name, "flush_commands") == 0) {
+      spawn_ns += systems[s].ns;
+    }
+  }
+  if (spawned > 0) {
+    printf("%-24s %12zu %12.2f  ns/spawn, entities grew by %zu\n", "spawned", spawned, (double)spawn_ns / spawned,
+           mock_entity_count() - entities_before);
+  }
+
+  if (input_path[0] != '\0' && !check_replay(&module, thumbs, input_path, options->replay != NULL)) return 1;
+  if (options->ffi && !report_engine_calls(&module, count, options->ffi_budget)) return 1;
+  if (options->snapshot && !round_trip_snapshot(&module, thumbs)) return 1;
+  if (options->autosave != NULL && !verify_autosave(&module, thumbs)) return 1;
+  // an F5 frame writes the warm start cache for the next run
+  if (options->warm_start != NULL && !options->snapshot) {
+    memset(input_state, 0, sizeof(input_state));
+    input_state[F5] = 0b01;
+    if (!run_frame(false)) return 1;
+    input_state[F5] = 0;
+  }
+  compare_ffi_paths(thumbs, count);
+  printf("\n");
+  fflush(stdout);
+
+  mock_query_free(thumbs);
+  free_systems();
+  module.deinit();
+  mock_reset();
+  dlclose(module.handle);
+  return 0;
+}
+
+// SCHEDULE
+
+// Mock scheduler: reads each system's declared access from the module and
+// packs the systems into stages whose members could run at the same time.
+// Two systems conflict when one writes a component, resource or event the
+// other reads or writes. A system keeps its declared order relative to every
+// system it conflicts with; one that declares nothing is treated as exclusive.
+
+#define MAX_ACCESS 32
+
+typedef struct {
+  const char *id;
+  bool write;
+} Access;
+
+typedef struct {
+  const char *name;
+  bool once;
+  size_t stage;
+  size_t access_len;
+  Access access[MAX_ACCESS];
+} ScheduledSystem;
+
+static void add_access(ScheduledSystem *system, const char *id, bool write) {
+  if (id == NULL) return;
+  for (size_t i = 0; i < system->access_len; i++) {
+    if (strcmp(system->access[i].id, id) == 0) {
+      system->access[i].write |= write;
+      return;
+    }
+  }
+  if (system->access_len < MAX_ACCESS) {
+    system->access[system->access_len++] = (Access){id, write};
+  }
+}
+
+// "void_public::Transform" -> "Transform"
+static const char* short_id(const char *id) {
+  const char *colon = strrchr(id, ':');
+  return colon != NULL ? colon + 1 : id;
+}
+
+// Writes the shared ids that make `a` and `b` conflict into `reason`
+static bool conflicts(const ScheduledSystem *a, const ScheduledSystem *b, char *reason, size_t cap) {
+  if (a->access_len == 0 || b->access_len == 0) {
+    snprintf(reason, cap, "exclusive");
+    return true;
+  }
+
+  size_t len = 0;
+  reason[0] = '\0';
+  for (size_t i = 0; i < a->access_len; i++) {
+    for (size_t j = 0; j < b->access_len; j++) {
+      if (strcmp(a->access[i].id, b->access[j].id) != 0) continue;
+      if (!a->access[i].write && !b->access[j].write) continue;
+      if (len < cap) {
+        len += snprintf(reason + len, cap - len, "%s%s", len > 0 ? ", " : "", short_id(a->access[i].id));
+      }
+    }
+  }
+  return reason[0] != '\0';
+}
+
+static void collect_access(Module *module, size_t s, ScheduledSystem *system) {
+  memset(system, 0, sizeof(ScheduledSystem));
+  system->name = module->system_name(s);
+  system->once = module->system_is_once(s);
+
+  size_t args_len = module->system_args_len(s);
+  for (size_t a = 0; a < args_len; a++) {
+    ArgType type = module->system_arg_type(s, a);
+
+    if (type == Query) {
+      size_t len = module->system_query_args_len(s, a);
+      for (size_t q = 0; q < len; q++) {
+        add_access(system, module->system_query_arg_component(s, a, q), module->system_query_arg_type(s, a, q) == DataAccessMut);
+      }
+    } else if (type == DataAccessRef || type == DataAccessMut) {
+      add_access(system, module->system_arg_component(s, a), type == DataAccessMut);
+    } else {
+      add_access(system, module->system_arg_event(s, a), type == EventWriter);
+    }
+  }
+}
+
+static int run_schedule(const Options *options) {
+  Module module;
+  ScheduledSystem scheduled[MAX_SYSTEMS];
+  size_t count = 0;
+  int saved = -1;
+
+  // the module logs metadata calls; keep the table readable
+  if (!options->verbose) silence_stdout(true, &saved);
+  bool loaded = module_open(&module, options->module_path);
+  if (loaded) {
+    module.load_engine_proc_addrs(mock_get_proc);
+    register_components(&module);
+    count = module.systems_len();
+    if (count > MAX_SYSTEMS) count = MAX_SYSTEMS;
+    for (size_t s = 0; s < count; s++) collect_access(&module, s, &scheduled[s]);
+    module.deinit();
+  }
+  if (!options->verbose) silence_stdout(false, &saved);
+  if (!loaded) return 1;
+
+  // greedy: each system lands one stage after the latest earlier system it conflicts with
+  char reasons[MAX_SYSTEMS][128] = {{0}};
+  const char *waits_on[MAX_SYSTEMS] = {0};
+  size_t stages = 0;
+  for (size_t s = 0; s < count; s++) {
+    char reason[128];
+    scheduled[s].stage = 1;
+    for (size_t p = 0; p < s; p++) {
+      if (!conflicts(&scheduled[s], &scheduled[p], reason, sizeof(reason))) continue;
+      if (scheduled[p].stage + 1 > scheduled[s].stage) {
+        scheduled[s].stage = scheduled[p].stage + 1;
+        waits_on[s] = scheduled[p].name;
+        memcpy(reasons[s], reason, sizeof(reason));
+      }
+    }
+    if (scheduled[s].stage > stages) stages = scheduled[s].stage;
+  }
+
+  printf("== %zu systems in %zu stages ==\n", count, stages);
+  for (size_t stage = 1; stage <= stages; stage++) {
+    printf("stage %zu\n", stage);
+    for (size_t s = 0; s < count; s++) {
+      if (scheduled[s].stage != stage) continue;
+      char name[64];
+      snprintf(name, sizeof(name), "%s%s", scheduled[s].name, scheduled[s].once ? " (once)" : "");
+      if (waits_on[s] != NULL) {
+        printf("  %-28s after %s: %s\n", name, waits_on[s], reasons[s]);
+      } else {
+        printf("  %s\n", name);
+      }
+    }
+  }
+
+  mock_reset();
+  dlclose(module.handle);
+  return 0;
+}
+
+static void usage(const char *argv0) {
+  printf("usage: %s [--module PATH] [--frames N] [--threads N] [--mode serial|parallel|soa] [--scaling] [--hold-mouse] [--burst] [--collide] [--pool N] [--seed N] [--schedule] [--trace PREFIX] [--ffi] [--ffi-budget F] [--snapshot] [--warm-start PREFIX] [--autosave PREFIX] [--record PREFIX] [--replay PREFIX] [--textures N] [--texture-index PATH] [--verbose] [sizes...]\n", argv0);
+  printf("  --scaling     run every size at 1, 2, 4, ... up to --threads (default: all cores)\n");
+  printf("  --hold-mouse  hold the left button so controller spawns a thumb every frame\n");
+  printf("  --burst       hold Space so controller spawns a burst of thumbs every frame\n");
+  printf("  --collide     bounce thumbs off each other, in a world scaled to a constant density\n");
+  printf("  --pool N      size of the module's thumb pool that spawns recycle (default %s)\n", DEFAULT_POOL);
+  printf("  --seed N      seed the module and host generators so runs repeat exactly\n");
+  printf("  --schedule    print which systems could run at the same time, from their declared access\n");
+  printf("  --trace P     write each run's Chrome trace to P-<thumbs>.json\n");
+  printf("  --ffi         count and time the module's engine calls in the last frame\n");
+  printf("  --ffi-budget F  like --ffi, and fail if they exceed F calls per thumb\n");
+  printf("  --snapshot    time saving and loading the game state, and check it round-trips\n");
+  printf("  --warm-start P  start each run from P-<thumbs>.snap if it exists, and write it at the end\n");
+  printf("  --autosave P  autosave continuously to P-<thumbs>.autosave, and check F9 loads it back\n");
+  printf("  --record P    record input, delta and seed to P-<thumbs>.input, and the world it ends on\n");
+  printf("  --replay P    play P-<thumbs>.input back instead of live input, and check the world matches\n");
+  printf("  --textures N  load a manifest of N more textures at startup, and report when they settle\n");
+  printf("  --texture-index P  dedupe texture loads by content, remembering the hashes in P across runs\n");
+}
+
+// each run gets its own process so module globals and memory start clean
+static bool run_forked(const Options *options, size_t size) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    exit(run_size(options, size));
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    printf("run with %zu thumbs on %zu threads failed\n", size, options->threads);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  Options options = {default_module, 0, 0, false, false, false, false, false, false, NULL, false, 0, false, NULL, NULL, NULL, NULL, 0};
+  size_t sizes[32];
+  size_t sizes_len = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--module") == 0 && i + 1 < argc) {
+      options.module_path = argv[++i];
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      options.frames = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      options.threads = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+      setenv("THUMB_MOVER_MODE", argv[++i], 1);
+    } else if (strcmp(argv[i], "--scaling") == 0) {
+      options.scaling = true;
+    } else if (strcmp(argv[i], "--hold-mouse") == 0) {
+      options.hold_mouse = true;
+    } else if (strcmp(argv[i], "--burst") == 0) {
+      options.burst = true;
+    } else if (strcmp(argv[i], "--collide") == 0) {
+      options.collide = true;
+    } else if (strcmp(argv[i], "--pool") == 0 && i + 1 < argc) {
+      setenv("THUMB_POOL", argv[++i], 1);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      setenv("FIASCO_SEED", argv[++i], 1);
+      uint64_t seed = strtoull(argv[i], NULL, 0);
+      if (seed != 0) rng_state = seed;
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      options.trace = argv[++i];
+    } else if (strcmp(argv[i], "--ffi") == 0) {
+      options.ffi = true;
+    } else if (strcmp(argv[i], "--ffi-budget") == 0 && i + 1 < argc) {
+      options.ffi = true;
+      options.ffi_budget = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--warm-start") == 0 && i + 1 < argc) {
+      options.warm_start = argv[++i];
+    } else if (strcmp(argv[i], "--autosave") == 0 && i + 1 < argc) {
+      options.autosave = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      options.record = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      options.replay = argv[++i];
+    } else if (strcmp(argv[i], "--textures") == 0 && i + 1 < argc) {
+      options.textures = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--texture-index") == 0 && i + 1 < argc) {
+      setenv("FIASCO_TEXTURE_INDEX", argv[++i], 1);
+    } else if (strcmp(argv[i], "--snapshot") == 0) {
+      options.snapshot = true;
+    } else if (strcmp(argv[i], "--schedule") == 0) {
+      options.schedule = true;
+    } else if (strcmp(argv[i], "--verbose") == 0) {
+      options.verbose = true;
+    } else if (argv[i][0] != '-' && sizes_len < 32) {
+      sizes[sizes_len++] = strtoull(argv[i], NULL, 10);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // the module collides by default; keep the plain runs comparable with older ones
+  setenv("THUMB_COLLISIONS", options.collide ? "1" : "0", 1);
+  setenv("THUMB_POOL", DEFAULT_POOL, 0);
+  if (options.ffi) {
+    setenv("FIASCO_FFI", "1", 1);
+    setenv("FIASCO_FFI_REPORT", "0", 0);
+  }
+
+  if (options.schedule) {
+    return run_schedule(&options);
+  }
+
+  if (sizes_len == 0) {
+    sizes_len = sizeof(default_sizes) / sizeof(default_sizes[0]);
+    memcpy(sizes, default_sizes, sizeof(default_sizes));
+  }
+
+  if (options.textures > 0) {
+    const char *manifest = write_texture_manifest(options.textures);
+    if (manifest == NULL) {
+      printf("could not write a texture manifest\n");
+      return 1;
+    }
+    setenv("FIASCO_TEXTURES", manifest, 1);
+  }
+
+  if (options.threads == 0) {
+    options.threads = options.scaling ? (size_t)sysconf(_SC_NPROCESSORS_ONLN) : 1;
+  }
+
+  int failed = 0;
+  for (size_t i = 0; i < sizes_len; i++) {
+    if (!options.scaling) {
+      failed |= !run_forked(&options, sizes[i]);
+      continue;
+    }
+
+    size_t max_threads = options.threads;
+    for (size_t threads = 1; ; threads *= 2) {
+      Options scaled = options;
+      scaled.threads = threads < max_threads ? threads : max_threads;
+      failed |= !run_forked(&scaled, sizes[i]);
+      if (scaled.threads == max_threads) break;
+    }
+  }
+
+  if (options.textures > 0) remove_texture_manifest(options.textures);
+  return failed;
+}
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <fiasco.h>
+
+// Input decode bench: checks input_decode's bitsets and edge list against
+// key() on random input buffers at every SIMD level, then times one decode
+// against the nine key() calls controller used to make each frame.
+
+#define INPUT_BUFFER 256
+#define CHECK_ROUNDS 10000
+#define BENCH_ROUNDS 1000000
+
+static const char *levels[] = {"scalar", "sse2", "avx2"};
+static const KeyCode controls[] = {KeyA, KeyW, KeyD, KeyS, Minus, Equal, KeyQ, KeyE, Space};
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Mostly idle keys with a few down or changing, like a real frame; the
+// cursor and mouse bytes get random garbage that must not leak into keys
+static void random_input(uint8_t *buffer) {
+  for (size_t i = 0; i < INPUT_BUFFER; i++) {
+    buffer[i] = random_float() < 0.9f ? 0 : (uint8_t)(random_float() * 256);
+  }
+}
+
+static bool check_frame(const uint8_t *buffer, const InputFrame *frame) {
+  size_t edge = 0;
+  for (int code = 0; code < INPUT_KEYS; code++) {
+    ButtonState state = key((KeyCode)code, (void*)buffer);
+    if (input_bit(frame->pressed, code) != state.isPressed || input_bit(frame->held, code) != state.isHeld ||
+        input_bit(frame->just_pressed, code) != state.justPressed ||
+        input_bit(frame->just_released, code) != state.justReleased) {
+      printf("  key %d decoded wrong\n", code);
+      return false;
+    }
+    if (state.justPressed || state.justReleased) {
+      if (edge >= frame->edges_len || frame->edges[edge] != code) {
+        printf("  edge list is missing key %d\n", code);
+        return false;
+      }
+      edge++;
+    }
+  }
+  for (int w = 0; w < INPUT_WORDS; w++) {
+    // bits past the last KeyCode stay clear
+    uint64_t tail = w == INPUT_KEYS / 64 ? ~0ull << (INPUT_KEYS % 64) : (w > INPUT_KEYS / 64 ? ~0ull : 0);
+    if ((frame->pressed[w] | frame->just_released[w]) & tail) {
+      printf("  bits past the last key are set\n");
+      return false;
+    }
+  }
+  return edge == frame->edges_len;
+}
+
+static bool check() {
+  uint8_t buffer[INPUT_BUFFER];
+  InputFrame frame;
+  for (int round = 0; round < CHECK_ROUNDS; round++) {
+    random_input(buffer);
+    input_decode(&frame, buffer);
+    if (!check_frame(buffer, &frame)) return false;
+  }
+  memset(buffer, 0, sizeof(buffer));
+  input_decode(&frame, buffer);
+  printf("  %d random frames match key(), empty frame is %s\n", CHECK_ROUNDS, frame.idle ? "idle" : "NOT IDLE");
+  return frame.idle;
+}
+
+static volatile int sink;
+
+static void bench() {
+  uint8_t buffer[INPUT_BUFFER];
+  random_input(buffer);
+  InputFrame frame;
+
+  uint64_t start = now_ns();
+  int held = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    buffer[0] = (uint8_t)round;
+    for (size_t k = 0; k < sizeof(controls) / sizeof(controls[0]); k++) {
+      held += key(controls[k], buffer).isHeld;
+    }
+    held += mouse(buffer).left.isHeld;
+  }
+  double key_ns = (double)(now_ns() - start) / BENCH_ROUNDS;
+
+  start = now_ns();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    buffer[0] = (uint8_t)round;
+    input_decode(&frame, buffer);
+    held += (int)frame.edges_len;
+  }
+  double decode_ns = (double)(now_ns() - start) / BENCH_ROUNDS;
+
+  start = now_ns();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    frame.held[0] ^= (uint64_t)round;
+    for (size_t k = 0; k < sizeof(controls) / sizeof(controls[0]); k++) {
+      held += input_bit(frame.held, controls[k]);
+    }
+    held += frame.mouse.left.isHeld;
+  }
+  double bit_ns = (double)(now_ns() - start) / BENCH_ROUNDS;
+
+  sink = held;
+  printf("  per frame: 9 key() + mouse() %.1f ns  decode %.1f ns  9 bit tests %.1f ns\n", key_ns, decode_ns, bit_ns);
+}
+
+int main(int argc, char **argv) {
+  int failed = 0;
+
+  for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      // simd_level() caches its first answer, so each level gets a fresh process
+      setenv("FIASCO_SIMD", levels[i], 1);
+      printf("%s (running %s)\n", levels[i], levels[simd_level()]);
+      bool ok = check();
+      bench();
+      exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+  }
+
+  return failed;
+}
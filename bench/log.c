@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fiasco.h>
+
+// Logging bench: cost per call of a message filtered out at run time, one
+// compiled out, one queued for the drain thread, and a plain printf. Output
+// goes to /dev/null so only the calling side is measured.
+
+#define CALLS 10000000
+// stays under the ring size so queued messages are never dropped
+#define BURST 512
+#define BURSTS 2000
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+
+  log_set_level(LogWarn);
+  uint64_t start = now_ns();
+  for (int i = 0; i < CALLS; i++) {
+    log_info("filtered %d", i);
+  }
+  double filtered_ns = (double)(now_ns() - start) / CALLS;
+
+  start = now_ns();
+  for (int i = 0; i < CALLS; i++) {
+    log_trace("compiled out %d", i);
+  }
+  double compiled_ns = (double)(now_ns() - start) / CALLS;
+
+  // the first message starts the drain thread; keep that out of the timing
+  log_warn("warm up");
+  log_flush();
+
+  uint64_t queued = 0;
+  for (int b = 0; b < BURSTS; b++) {
+    start = now_ns();
+    for (int i = 0; i < BURST; i++) {
+      log_warn("thumb query get failed for %d", i);
+    }
+    queued += now_ns() - start;
+    log_flush();
+  }
+  double queued_ns = (double)queued / ((double)BURST * BURSTS);
+
+  uint64_t printed = 0;
+  for (int b = 0; b < BURSTS; b++) {
+    start = now_ns();
+    for (int i = 0; i < BURST; i++) {
+      printf("thumb query get failed for %d\n", i);
+    }
+    printed += now_ns() - start;
+    fflush(stdout);
+  }
+  double printf_ns = (double)printed / ((double)BURST * BURSTS);
+
+  log_stop();
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+
+  printf("  filtered %.2f ns/call  compiled out %.2f ns/call  queued %.2f ns/call  printf %.2f ns/call\n",
+         filtered_ns, compiled_ns, queued_ns, printf_ns);
+  return 0;
+}
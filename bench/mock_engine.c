@@ -0,0 +1,754 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <mock_engine.h>
+
+#define MOCK_MAX_BUNDLE 16
+#define MOCK_MAX_THREADS 64
+#define MOCK_TEXTURE_LATENCY 2
+#define MOCK_FIRST_TEXTURE_ID 2
+
+// COMPONENT REGISTRY
+
+static char *component_names[MOCK_MAX_COMPONENTS];
+static size_t component_sizes[MOCK_MAX_COMPONENTS];
+static size_t components_len = 0;
+
+ComponentId mock_register_component(const char *string_id, size_t size) {
+  ComponentId existing = mock_component_id(string_id);
+  if (existing != 0) {
+    if (size != 0) component_sizes[existing] = size;
+    return existing;
+  }
+
+  // 0 is reserved so a failed module lookup never aliases a real component
+  if (components_len == 0) components_len = 1;
+  if (components_len >= MOCK_MAX_COMPONENTS) {
+    printf("mock: component registry full, dropping %s\n", string_id);
+    return 0;
+  }
+
+  ComponentId id = (ComponentId)components_len++;
+  component_names[id] = strdup(string_id);
+  component_sizes[id] = size;
+  return id;
+}
+
+ComponentId mock_component_id(const char *string_id) {
+  for (size_t i = 1; i < components_len; i++) {
+    if (strcmp(component_names[i], string_id) == 0) return (ComponentId)i;
+  }
+  return 0;
+}
+
+size_t mock_component_size(ComponentId id) {
+  return id < components_len ? component_sizes[id] : 0;
+}
+
+size_t mock_components_len() {
+  return components_len;
+}
+
+const char* mock_component_string_id(ComponentId id) {
+  return id < components_len ? component_names[id] : NULL;
+}
+
+// WORLD
+
+typedef struct {
+  size_t len;
+  ComponentId ids[MOCK_MAX_BUNDLE];
+  size_t sizes[MOCK_MAX_BUNDLE];
+  uint8_t *columns[MOCK_MAX_BUNDLE];
+  EntityId *entities;
+  size_t rows;
+  size_t cap;
+} Archetype;
+
+typedef struct {
+  uint32_t archetype;
+  uint32_t row;
+  bool alive;
+} Location;
+
+static struct {
+  Archetype *archetypes;
+  size_t archetypes_len;
+  size_t archetypes_cap;
+  uint64_t version;
+  Location *locations;
+  size_t locations_len;
+  size_t locations_cap;
+  size_t entity_count;
+} world;
+
+struct MockQuery {
+  size_t len;
+  ComponentId ids[MOCK_MAX_QUERY];
+  uint64_t version;
+  size_t *archetypes;
+  size_t *columns;
+  size_t archetypes_len;
+};
+
+static void sort_ids(ComponentId *ids, size_t *order, size_t len) {
+  for (size_t i = 0; i < len; i++) order[i] = i;
+  for (size_t i = 1; i < len; i++) {
+    size_t o = order[i];
+    size_t j = i;
+    while (j > 0 && ids[order[j - 1]] > ids[o]) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = o;
+  }
+}
+
+static size_t find_archetype(const ComponentId *ids, const size_t *sizes, size_t len) {
+  for (size_t i = 0; i < world.archetypes_len; i++) {
+    Archetype *arch = &world.archetypes[i];
+    if (arch->len == len && memcmp(arch->ids, ids, len * sizeof(ComponentId)) == 0) {
+      return i;
+    }
+  }
+
+  if (world.archetypes_len == world.archetypes_cap) {
+    world.archetypes_cap = world.archetypes_cap ? world.archetypes_cap * 2 : 8;
+    world.archetypes = realloc(world.archetypes, world.archetypes_cap * sizeof(Archetype));
+  }
+
+  Archetype *arch = &world.archetypes[world.archetypes_len];
+  memset(arch, 0, sizeof(Archetype));
+  arch->len = len;
+  memcpy(arch->ids, ids, len * sizeof(ComponentId));
+  memcpy(arch->sizes, sizes, len * sizeof(size_t));
+  world.version++;
+  return world.archetypes_len++;
+}
+
+static size_t archetype_push(Archetype *arch, EntityId entity) {
+  if (arch->rows == arch->cap) {
+    arch->cap = arch->cap ? arch->cap * 2 : 64;
+    for (size_t c = 0; c < arch->len; c++) {
+      arch->columns[c] = realloc(arch->columns[c], arch->cap * (arch->sizes[c] ? arch->sizes[c] : 1));
+    }
+    arch->entities = realloc(arch->entities, arch->cap * sizeof(EntityId));
+  }
+  arch->entities[arch->rows] = entity;
+  return arch->rows++;
+}
+
+static EntityId next_entity(uint32_t archetype, uint32_t row) {
+  if (world.locations_len == world.locations_cap) {
+    world.locations_cap = world.locations_cap ? world.locations_cap * 2 : 1024;
+    world.locations = realloc(world.locations, world.locations_cap * sizeof(Location));
+  }
+  // entity 0 is never handed out
+  if (world.locations_len == 0) {
+    world.locations[0] = (Location){0, 0, false};
+    world.locations_len = 1;
+  }
+  world.locations[world.locations_len] = (Location){archetype, row, true};
+  world.entity_count++;
+  return (EntityId)world.locations_len++;
+}
+
+static EntityId mock_spawn(const ComponentRef *refs, size_t count) {
+  if (count > MOCK_MAX_BUNDLE) {
+    printf("mock: spawn bundle of %zu exceeds %d components\n", count, MOCK_MAX_BUNDLE);
+    return 0;
+  }
+
+  ComponentId raw[MOCK_MAX_BUNDLE];
+  size_t order[MOCK_MAX_BUNDLE];
+  for (size_t i = 0; i < count; i++) raw[i] = refs[i].component_id;
+  sort_ids(raw, order, count);
+
+  ComponentId ids[MOCK_MAX_BUNDLE];
+  size_t sizes[MOCK_MAX_BUNDLE];
+  for (size_t i = 0; i < count; i++) {
+    ids[i] = raw[order[i]];
+    sizes[i] = refs[order[i]].component_size;
+  }
+
+  size_t index = find_archetype(ids, sizes, count);
+  Archetype *arch = &world.archetypes[index];
+  EntityId entity = next_entity((uint32_t)index, (uint32_t)arch->rows);
+  size_t row = archetype_push(arch, entity);
+
+  for (size_t i = 0; i < count; i++) {
+    memcpy(arch->columns[i] + row * arch->sizes[i], refs[order[i]].component_val, arch->sizes[i]);
+  }
+
+  return entity;
+}
+
+static void mock_despawn(EntityId entity) {
+  if (entity == 0 || entity >= world.locations_len || !world.locations[entity].alive) return;
+
+  Location loc = world.locations[entity];
+  Archetype *arch = &world.archetypes[loc.archetype];
+  size_t last = arch->rows - 1;
+
+  if (loc.row != last) {
+    for (size_t c = 0; c < arch->len; c++) {
+      memcpy(arch->columns[c] + loc.row * arch->sizes[c], arch->columns[c] + last * arch->sizes[c], arch->sizes[c]);
+    }
+    EntityId moved = arch->entities[last];
+    arch->entities[loc.row] = moved;
+    world.locations[moved].row = loc.row;
+  }
+
+  arch->rows--;
+  world.locations[entity].alive = false;
+  world.entity_count--;
+}
+
+EntityId mock_clone_entity(EntityId src) {
+  if (src == 0 || src >= world.locations_len || !world.locations[src].alive) return 0;
+
+  Location loc = world.locations[src];
+  Archetype *arch = &world.archetypes[loc.archetype];
+  EntityId entity = next_entity(loc.archetype, (uint32_t)arch->rows);
+  size_t row = archetype_push(arch, entity);
+
+  for (size_t c = 0; c < arch->len; c++) {
+    memcpy(arch->columns[c] + row * arch->sizes[c], arch->columns[c] + loc.row * arch->sizes[c], arch->sizes[c]);
+  }
+
+  return entity;
+}
+
+void* mock_entity_component(EntityId entity, ComponentId id) {
+  if (entity == 0 || entity >= world.locations_len || !world.locations[entity].alive) return NULL;
+
+  Location loc = world.locations[entity];
+  Archetype *arch = &world.archetypes[loc.archetype];
+  for (size_t c = 0; c < arch->len; c++) {
+    if (arch->ids[c] == id) return arch->columns[c] + loc.row * arch->sizes[c];
+  }
+  return NULL;
+}
+
+size_t mock_entity_count() {
+  return world.entity_count;
+}
+
+// QUERIES
+
+MockQuery* mock_query_new(const ComponentId *ids, size_t len) {
+  MockQuery *query = calloc(1, sizeof(MockQuery));
+  query->len = len > MOCK_MAX_QUERY ? MOCK_MAX_QUERY : len;
+  memcpy(query->ids, ids, query->len * sizeof(ComponentId));
+  query->version = UINT64_MAX;
+  return query;
+}
+
+void mock_query_free(MockQuery *query) {
+  if (query == NULL) return;
+  free(query->archetypes);
+  free(query->columns);
+  free(query);
+}
+
+static void query_refresh(MockQuery *query) {
+  if (query->version == world.version) return;
+
+  query->archetypes = realloc(query->archetypes, (world.archetypes_len + 1) * sizeof(size_t));
+  query->columns = realloc(query->columns, (world.archetypes_len + 1) * MOCK_MAX_QUERY * sizeof(size_t));
+  query->archetypes_len = 0;
+
+  for (size_t a = 0; a < world.archetypes_len; a++) {
+    Archetype *arch = &world.archetypes[a];
+    size_t *columns = &query->columns[query->archetypes_len * MOCK_MAX_QUERY];
+    bool matched = true;
+
+    for (size_t q = 0; q < query->len && matched; q++) {
+      matched = false;
+      for (size_t c = 0; c < arch->len; c++) {
+        if (arch->ids[c] == query->ids[q]) {
+          columns[q] = c;
+          matched = true;
+          break;
+        }
+      }
+    }
+
+    if (matched) query->archetypes[query->archetypes_len++] = a;
+  }
+
+  query->version = world.version;
+}
+
+static inline void row_ptrs(const MockQuery *query, size_t matched, size_t row, const void **ptrs) {
+  Archetype *arch = &world.archetypes[query->archetypes[matched]];
+  const size_t *columns = &query->columns[matched * MOCK_MAX_QUERY];
+  for (size_t q = 0; q < query->len; q++) {
+    ptrs[q] = arch->columns[columns[q]] + row * arch->sizes[columns[q]];
+  }
+}
+
+static size_t mock_query_len(const void *arg_ptr) {
+  MockQuery *query = (MockQuery*)arg_ptr;
+  query_refresh(query);
+
+  size_t len = 0;
+  for (size_t m = 0; m < query->archetypes_len; m++) {
+    len += world.archetypes[query->archetypes[m]].rows;
+  }
+  return len;
+}
+
+static int mock_query_get(const void *arg_ptr, size_t index, const void **component_ptrs) {
+  MockQuery *query = (MockQuery*)arg_ptr;
+  query_refresh(query);
+
+  for (size_t m = 0; m < query->archetypes_len; m++) {
+    size_t rows = world.archetypes[query->archetypes[m]].rows;
+    if (index < rows) {
+      row_ptrs(query, m, index, component_ptrs);
+      return 0;
+    }
+    index -= rows;
+  }
+  return 1;
+}
+
+EntityId mock_query_entity(MockQuery *query, size_t index) {
+  query_refresh(query);
+
+  for (size_t m = 0; m < query->archetypes_len; m++) {
+    Archetype *arch = &world.archetypes[query->archetypes[m]];
+    if (index < arch->rows) return arch->entities[index];
+    index -= arch->rows;
+  }
+  return 0;
+}
+
+static int mock_query_get_entity(void *arg_ptr, EntityId entity, const void **component_ptrs) {
+  MockQuery *query = (MockQuery*)arg_ptr;
+  query_refresh(query);
+
+  if (entity == 0 || entity >= world.locations_len || !world.locations[entity].alive) return 1;
+
+  Location loc = world.locations[entity];
+  for (size_t m = 0; m < query->archetypes_len; m++) {
+    if (query->archetypes[m] == loc.archetype) {
+      row_ptrs(query, m, loc.row, component_ptrs);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void mock_query_for_each(const void *arg_ptr, for_each_t callback, const void *user_data) {
+  MockQuery *query = (MockQuery*)arg_ptr;
+  query_refresh(query);
+
+  const void *ptrs[MOCK_MAX_QUERY];
+  for (size_t m = 0; m < query->archetypes_len; m++) {
+    size_t rows = world.archetypes[query->archetypes[m]].rows;
+    for (size_t row = 0; row < rows; row++) {
+      row_ptrs(query, m, row, ptrs);
+      if (callback(ptrs, (void*)user_data) != 0) return;
+    }
+  }
+}
+
+// PARALLEL ITERATION
+
+typedef struct {
+  MockQuery *query;
+  para_for_each_t callback;
+  const void *user_data;
+  size_t total;
+  size_t chunks;
+} ParTask;
+
+static struct {
+  pthread_t threads[MOCK_MAX_THREADS];
+  size_t workers;
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  uint64_t generation;
+  size_t pending;
+  ParTask task;
+} pool = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .start = PTHREAD_COND_INITIALIZER,
+  .done = PTHREAD_COND_INITIALIZER,
+};
+
+static void run_chunk(const ParTask *task, size_t chunk) {
+  size_t begin = task->total * chunk / task->chunks;
+  size_t end = task->total * (chunk + 1) / task->chunks;
+  const void *ptrs[MOCK_MAX_QUERY];
+
+  size_t base = 0;
+  for (size_t m = 0; m < task->query->archetypes_len && base < end; m++) {
+    size_t rows = world.archetypes[task->query->archetypes[m]].rows;
+    size_t lo = begin > base ? begin - base : 0;
+    size_t hi = end - base < rows ? end - base : rows;
+    for (size_t row = lo; row < hi; row++) {
+      row_ptrs(task->query, m, row, ptrs);
+      task->callback(ptrs, task->user_data);
+    }
+    base += rows;
+  }
+}
+
+static void* worker_main(void *arg) {
+  size_t chunk = (size_t)arg;
+  uint64_t seen = 0;
+
+  pthread_mutex_lock(&pool.lock);
+  for (;;) {
+    while (pool.generation == seen) pthread_cond_wait(&pool.start, &pool.lock);
+    seen = pool.generation;
+    ParTask task = pool.task;
+    pthread_mutex_unlock(&pool.lock);
+
+    if (chunk < task.chunks) run_chunk(&task, chunk);
+
+    pthread_mutex_lock(&pool.lock);
+    if (--pool.pending == 0) pthread_cond_signal(&pool.done);
+  }
+  return NULL;
+}
+
+void mock_set_threads(size_t threads) {
+  if (threads < 1) threads = 1;
+  if (threads > MOCK_MAX_THREADS) threads = MOCK_MAX_THREADS;
+
+  // workers are only ever added; extra ones idle on an empty chunk
+  while (pool.workers + 1 < threads) {
+    pthread_create(&pool.threads[pool.workers], NULL, worker_main, (void*)(pool.workers + 1));
+    pool.workers++;
+  }
+  pool.task.chunks = threads;
+}
+
+size_t mock_threads() {
+  return pool.task.chunks ? pool.task.chunks : 1;
+}
+
+static void mock_query_par_for_each(const void *arg_ptr, para_for_each_t callback, const void *user_data) {
+  MockQuery *query = (MockQuery*)arg_ptr;
+  size_t total = mock_query_len(query);
+  ParTask task = {query, callback, user_data, total, mock_threads()};
+
+  if (task.chunks == 1 || pool.workers == 0) {
+    task.chunks = 1;
+    run_chunk(&task, 0);
+    return;
+  }
+
+  pthread_mutex_lock(&pool.lock);
+  pool.task = task;
+  pool.pending = pool.workers;
+  pool.generation++;
+  pthread_cond_broadcast(&pool.start);
+  pthread_mutex_unlock(&pool.lock);
+
+  run_chunk(&task, 0);
+
+  pthread_mutex_lock(&pool.lock);
+  while (pool.pending > 0) pthread_cond_wait(&pool.done, &pool.lock);
+  pthread_mutex_unlock(&pool.lock);
+}
+
+void mock_reset() {
+  for (size_t a = 0; a < world.archetypes_len; a++) {
+    Archetype *arch = &world.archetypes[a];
+    for (size_t c = 0; c < arch->len; c++) free(arch->columns[c]);
+    free(arch->entities);
+  }
+  free(world.archetypes);
+  free(world.locations);
+  uint64_t version = world.version;
+  memset(&world, 0, sizeof(world));
+  world.version = version + 1;
+}
+
+// TEXTURE ASSET MANAGER
+
+typedef struct {
+  char *path;
+  TextureId id;
+  uint32_t width;
+  uint32_t height;
+  uint64_t ready_frame;
+  bool exists;
+  bool insert_in_atlas;
+} MockTexture;
+
+static struct {
+  MockTexture *textures;
+  size_t len;
+  size_t cap;
+  TextureId next_id;
+  uint64_t frame;
+} texture_manager = {.next_id = MOCK_FIRST_TEXTURE_ID};
+
+static uint8_t gpu_interface_dummy;
+
+void mock_next_frame() {
+  texture_manager.frame++;
+}
+
+static MockTexture* texture_by_id(TextureId id) {
+  for (size_t i = 0; i < texture_manager.len; i++) {
+    if (texture_manager.textures[i].id == id) return &texture_manager.textures[i];
+  }
+  return NULL;
+}
+
+static MockTexture* texture_by_path(const char *path) {
+  for (size_t i = 0; i < texture_manager.len; i++) {
+    if (strcmp(texture_manager.textures[i].path, path) == 0) return &texture_manager.textures[i];
+  }
+  return NULL;
+}
+
+static TextureId mock_white_texture_id() {
+  return 0;
+}
+
+static TextureId mock_missing_texture_id() {
+  return 1;
+}
+
+static TextureId mock_register_next_texture_id(void *gpu_interface) {
+  return texture_manager.next_id++;
+}
+
+static TextureHash mock_generate_hash(const uint8_t *bytes, uint32_t len) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (uint32_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+
+  TextureHash out;
+  for (int i = 0; i < 8; i++) out.hash[i] = (uint8_t)(hash >> (i * 8));
+  return out;
+}
+
+static uint32_t mock_create_pending_texture(TextureId id, const char *path, bool insert_in_atlas, PendingTexture *out) {
+  out->id = id;
+  out->path = path;
+  out->insert_in_atlas = insert_in_atlas;
+  return 0;
+}
+
+static void mock_free_pending_texture(PendingTexture *texture) {}
+static void mock_free_engine_texture(EngineTexture *texture) {}
+static void mock_free_loaded_texture(LoadedTexture *texture) {}
+static void mock_free_failed_texture(FailedTexture *texture) {}
+
+static TextureType texture_type(const MockTexture *texture) {
+  if (texture == NULL) return FailedType;
+  if (texture_manager.frame < texture->ready_frame) return PendingType;
+  return texture->exists ? LoadedType : FailedType;
+}
+
+static TextureType mock_get_texture_type_by_id(void *manager, TextureId id) {
+  if (id == mock_white_texture_id() || id == mock_missing_texture_id()) return EngineType;
+  return texture_type(texture_by_id(id));
+}
+
+static TextureType mock_get_texture_type_by_path(void *manager, const char *path) {
+  return texture_type(texture_by_path(path));
+}
+
+static uint32_t fill_pending(const MockTexture *texture, PendingTexture *out) {
+  if (texture_type(texture) != PendingType) return 1;
+  out->id = texture->id;
+  out->path = texture->path;
+  out->insert_in_atlas = texture->insert_in_atlas;
+  return 0;
+}
+
+static uint32_t fill_engine(TextureId id, EngineTexture *out) {
+  if (id != mock_white_texture_id() && id != mock_missing_texture_id()) return 1;
+  out->texture_path = id == 0 ? "white" : "missing";
+  out->id = id;
+  out->width = 1;
+  out->height = 1;
+  out->in_atlas = false;
+  return 0;
+}
+
+static uint32_t fill_loaded(const MockTexture *texture, LoadedTexture *out) {
+  if (texture_type(texture) != LoadedType) return 1;
+  out->version = mock_generate_hash((const uint8_t*)texture->path, (uint32_t)strlen(texture->path));
+  out->texture_path = texture->path;
+  out->format_type = "png";
+  out->id = texture->id;
+  out->width = texture->width;
+  out->height = texture->height;
+  out->insert_in_atlas = texture->insert_in_atlas;
+  return 0;
+}
+
+static uint32_t fill_failed(const MockTexture *texture, FailedTexture *out) {
+  if (texture == NULL || texture_type(texture) != FailedType) return 1;
+  out->texture_path = texture->path;
+  out->failure_reason = "file not found";
+  out->id = texture->id;
+  return 0;
+}
+
+static uint32_t mock_get_pending_texture_by_id(void *m, TextureId id, PendingTexture *out) { return fill_pending(texture_by_id(id), out); }
+static uint32_t mock_get_engine_texture_by_id(void *m, TextureId id, EngineTexture *out) { return fill_engine(id, out); }
+static uint32_t mock_get_loaded_texture_by_id(void *m, TextureId id, LoadedTexture *out) { return fill_loaded(texture_by_id(id), out); }
+static uint32_t mock_get_failed_texture_by_id(void *m, TextureId id, FailedTexture *out) { return fill_failed(texture_by_id(id), out); }
+static uint32_t mock_get_pending_texture_by_path(void *m, const char *path, PendingTexture *out) { return fill_pending(texture_by_path(path), out); }
+static uint32_t mock_get_engine_texture_by_path(void *m, const char *path, EngineTexture *out) { return 1; }
+static uint32_t mock_get_loaded_texture_by_path(void *m, const char *path, LoadedTexture *out) { return fill_loaded(texture_by_path(path), out); }
+static uint32_t mock_get_failed_texture_by_path(void *m, const char *path, FailedTexture *out) { return fill_failed(texture_by_path(path), out); }
+
+static bool mock_is_id_loaded(void *manager, TextureId id) {
+  TextureType type = mock_get_texture_type_by_id(manager, id);
+  return type == LoadedType || type == EngineType;
+}
+
+static bool mock_are_ids_loaded(void *manager, const TextureId *ids, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    if (!mock_is_id_loaded(manager, ids[i])) return false;
+  }
+  return true;
+}
+
+// Reads width/height from the IHDR chunk; anything that is not a PNG loads as 1x1
+static bool read_png_size(const char *path, uint32_t *width, uint32_t *height) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return false;
+
+  uint8_t header[24];
+  size_t read = fread(header, 1, sizeof(header), file);
+  fclose(file);
+
+  *width = 1;
+  *height = 1;
+  if (read == sizeof(header) && memcmp(header + 1, "PNG", 3) == 0) {
+    *width = (uint32_t)header[16] << 24 | (uint32_t)header[17] << 16 | (uint32_t)header[18] << 8 | header[19];
+    *height = (uint32_t)header[20] << 24 | (uint32_t)header[21] << 16 | (uint32_t)header[22] << 8 | header[23];
+  }
+  return true;
+}
+
+static uint32_t mock_load_texture(void *manager, const void *event_writer, char *path, bool in_atlas, const PendingTexture *texture) {
+  if (manager == NULL) return TextureAssetManagerNull;
+  if (texture == NULL) return OutputPendingTextureNull;
+
+  if (texture_manager.len == texture_manager.cap) {
+    texture_manager.cap = texture_manager.cap ? texture_manager.cap * 2 : 16;
+    texture_manager.textures = realloc(texture_manager.textures, texture_manager.cap * sizeof(MockTexture));
+  }
+
+  MockTexture *loaded = &texture_manager.textures[texture_manager.len++];
+  memset(loaded, 0, sizeof(MockTexture));
+  loaded->path = strdup(path);
+  loaded->id = texture_manager.next_id++;
+  loaded->ready_frame = texture_manager.frame + MOCK_TEXTURE_LATENCY;
+  loaded->insert_in_atlas = in_atlas;
+  loaded->exists = read_png_size(path, &loaded->width, &loaded->height);
+
+  PendingTexture *out = (PendingTexture*)texture;
+  out->id = loaded->id;
+  out->path = loaded->path;
+  out->insert_in_atlas = in_atlas;
+  return LoadPendingTextureSuccess;
+}
+
+static void* mock_get_texture_asset_manager_mut(void *gpu_interface) {
+  return &texture_manager;
+}
+
+// UNSUPPORTED STUBS
+
+static void mock_call(ComponentId id, const void *args, size_t len) {}
+static void mock_call_async(ComponentId id, const void *args, size_t len, const void *user, size_t user_len) {}
+static size_t mock_event_count(const void *reader) { return 0; }
+static const unsigned long* mock_event_get(const void *reader, size_t index) { return NULL; }
+static void mock_event_send(const void *writer, const char *data, size_t len) {}
+static bool mock_get_parent(EntityId entity, unsigned long *parent) { return false; }
+static void mock_set_parent(EntityId entity, EntityId parent, bool keep_transform) {}
+static void mock_set_system_enabled(const char *name, bool enabled) {}
+
+static void mock_add_components(EntityId entity, size_t size, const ComponentRef *refs, size_t len) {
+  printf("mock: add_components is not supported\n");
+}
+
+static void mock_remove_components(EntityId entity, const ComponentId *ids, size_t len) {
+  printf("mock: remove_components is not supported\n");
+}
+
+// PROC TABLE
+
+typedef struct {
+  const char *name;
+  void *proc;
+} Proc;
+
+#define PROC(name, fn) {name, (void*)fn}
+
+static const Proc procs[] = {
+  PROC("call", mock_call),
+  PROC("call_async", mock_call_async),
+  PROC("despawn", mock_despawn),
+  PROC("event_count", mock_event_count),
+  PROC("event_get", mock_event_get),
+  PROC("event_send", mock_event_send),
+  PROC("get_parent", mock_get_parent),
+  PROC("set_parent", mock_set_parent),
+  PROC("set_system_enabled", mock_set_system_enabled),
+  PROC("spawn", mock_spawn),
+  PROC("query_for_each", mock_query_for_each),
+  PROC("query_get", mock_query_get),
+  PROC("query_get_entity", mock_query_get_entity),
+  PROC("query_len", mock_query_len),
+  PROC("query_par_for_each", mock_query_par_for_each),
+  PROC("add_components", mock_add_components),
+  PROC("remove_components", mock_remove_components),
+
+  PROC("texture_asset_manager_white_texture_id", mock_white_texture_id),
+  PROC("texture_asset_manager_missing_texture_id", mock_missing_texture_id),
+  PROC("texture_asset_manager_register_next_texture_id", mock_register_next_texture_id),
+  PROC("texture_asset_manager_generate_hash", mock_generate_hash),
+  PROC("texture_asset_manager_create_pending_texture", mock_create_pending_texture),
+  PROC("texture_asset_manager_free_pending_texture", mock_free_pending_texture),
+  PROC("texture_asset_manager_free_engine_texture", mock_free_engine_texture),
+  PROC("texture_asset_manager_free_loaded_texture", mock_free_loaded_texture),
+  PROC("texture_asset_manager_free_failed_texture", mock_free_failed_texture),
+  PROC("texture_asset_manager_get_texture_type_by_id", mock_get_texture_type_by_id),
+  PROC("texture_asset_manager_get_pending_texture_by_id", mock_get_pending_texture_by_id),
+  PROC("texture_asset_manager_get_engine_texture_by_id", mock_get_engine_texture_by_id),
+  PROC("texture_asset_manager_get_loaded_texture_by_id", mock_get_loaded_texture_by_id),
+  PROC("texture_asset_manager_get_failed_texture_by_id", mock_get_failed_texture_by_id),
+  PROC("texture_asset_manager_get_texture_type_by_path", mock_get_texture_type_by_path),
+  PROC("texture_asset_manager_get_pending_texture_by_path", mock_get_pending_texture_by_path),
+  PROC("texture_asset_manager_get_engine_texture_by_path", mock_get_engine_texture_by_path),
+  PROC("texture_asset_manager_get_loaded_texture_by_path", mock_get_loaded_texture_by_path),
+  PROC("texture_asset_manager_get_failed_texture_by_path", mock_get_failed_texture_by_path),
+  PROC("texture_asset_manager_are_ids_loaded", mock_are_ids_loaded),
+  PROC("texture_asset_manager_is_id_loaded", mock_is_id_loaded),
+  PROC("texture_asset_manager_load_texture", mock_load_texture),
+  PROC("gpu_interface_get_texture_asset_manager_mut", mock_get_texture_asset_manager_mut),
+};
+
+void* mock_get_proc(const char *name) {
+  for (size_t i = 0; i < sizeof(procs) / sizeof(procs[0]); i++) {
+    if (strcmp(procs[i].name, name) == 0) return procs[i].proc;
+  }
+  printf("mock: no proc named %s\n", name);
+  return NULL;
+}
+
+void* mock_gpu_interface() {
+  return &gpu_interface_dummy;
+}
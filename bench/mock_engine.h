@@ -0,0 +1,39 @@
+#ifndef MOCK_ENGINE_H
+#define MOCK_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fiasco.h>
+
+// In-process stand-in for the Fiasco engine. Implements every `Engine`
+// function pointer the module resolves in `load_engine_proc_addrs`, backed
+// by a small archetype ECS so systems can be driven without a GPU.
+
+#define MOCK_MAX_COMPONENTS 128
+#define MOCK_MAX_QUERY 8
+
+typedef struct MockQuery MockQuery;
+
+void mock_reset();
+void mock_set_threads(size_t threads);
+size_t mock_threads();
+void mock_next_frame();
+
+ComponentId mock_register_component(const char *string_id, size_t size);
+ComponentId mock_component_id(const char *string_id);
+size_t mock_component_size(ComponentId id);
+size_t mock_components_len();
+const char* mock_component_string_id(ComponentId id);
+
+MockQuery* mock_query_new(const ComponentId *ids, size_t len);
+void mock_query_free(MockQuery *query);
+EntityId mock_query_entity(MockQuery *query, size_t index);
+
+size_t mock_entity_count();
+EntityId mock_clone_entity(EntityId src);
+void* mock_entity_component(EntityId entity, ComponentId id);
+
+void* mock_get_proc(const char *name);
+void* mock_gpu_interface();
+
+#endif
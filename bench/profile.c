@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fiasco.h>
+#include <profiler.h>
+
+// Profiler bench: checks histogram quantiles against exact ones from sorted
+// samples, then times a system called directly and through its timing shim.
+
+#define SAMPLES 1000000
+#define CALLS 10000000
+// bucket width over bucket start, for 5 sub-bucket bits
+#define MAX_ERROR (1.0 / (1 << HISTOGRAM_SUB_BITS))
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+// Latency-shaped samples: mostly around 10us with a long tail into the ms
+static bool check_quantiles() {
+  static LatencyHistogram histogram;
+  uint64_t *samples = malloc(SAMPLES * sizeof(uint64_t));
+
+  random_seed(42);
+  for (size_t i = 0; i < SAMPLES; i++) {
+    float u = random_float_range(1e-6f, 1.0f);
+    samples[i] = (uint64_t)(10000.0 * exp(-log(u) * 0.6));
+    histogram_record(&histogram, samples[i]);
+  }
+  qsort(samples, SAMPLES, sizeof(uint64_t), compare_u64);
+
+  const double quantiles[] = {0.5, 0.99, 0.999};
+  bool ok = histogram_count(&histogram) == SAMPLES;
+  for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+    size_t rank = (size_t)(quantiles[q] * SAMPLES + 0.5);
+    uint64_t exact = samples[rank > 0 ? rank - 1 : 0];
+    uint64_t estimate = histogram_quantile(&histogram, quantiles[q]);
+    double error = fabs((double)estimate - (double)exact) / (double)exact;
+    ok &= error <= MAX_ERROR;
+    printf("  p%-5g exact %10llu ns  histogram %10llu ns  error %.2f%%\n", quantiles[q] * 100,
+           (unsigned long long)exact, (unsigned long long)estimate, error * 100);
+  }
+
+  free(samples);
+  return ok;
+}
+
+static volatile int calls;
+
+static int empty_system(const void **args) {
+  calls++;
+  return 0;
+}
+
+static double time_calls(system_func fn) {
+  uint64_t start = now_ns();
+  for (int i = 0; i < CALLS; i++) fn(NULL);
+  return (double)(now_ns() - start) / CALLS;
+}
+
+int main(int argc, char **argv) {
+  bool ok = check_quantiles();
+  printf("  quantiles within %.1f%%: %s\n", MAX_ERROR * 100, ok ? "ok" : "FAILED");
+
+  // profiler_enabled caches its first answer
+  setenv("FIASCO_PROFILE", "1", 1);
+  system_func volatile direct = empty_system;
+  system_func volatile wrapped = profiler_wrap(0, "empty_system", empty_system);
+
+  double direct_ns = time_calls(direct);
+  double wrapped_ns = time_calls(wrapped);
+  printf("  direct %.2f ns/call  profiled %.2f ns/call  shim overhead %.2f ns/call\n", direct_ns, wrapped_ns, wrapped_ns - direct_ns);
+  return !ok;
+}
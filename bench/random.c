@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <fiasco.h>
+
+// PRNG bench: checks that every SIMD level draws the same stream for a seed,
+// then times rand() against random_float and the bulk random_floats.
+
+#define CHECK_LEN 100003
+#define BENCH_LEN 1000000
+#define BENCH_ROUNDS 20
+#define SEED 42
+
+static const char *levels[] = {"scalar", "sse2", "avx2"};
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Mixes single and bulk draws with odd lengths so the buffered tail is covered
+static uint64_t stream_checksum() {
+  float *values = malloc(CHECK_LEN * sizeof(float));
+  uint64_t hash = 14695981039346656037ull;
+  bool in_range = true;
+
+  random_seed(SEED);
+  for (size_t len = 1, done = 0; done < CHECK_LEN; len = len * 3 % 97 + 1) {
+    if (len > CHECK_LEN - done) len = CHECK_LEN - done;
+    if (len % 5 == 0) {
+      values[done] = random_float_range(-2.0f, 3.0f);
+      len = 1;
+    } else {
+      random_floats(values + done, len, -2.0f, 3.0f);
+    }
+    done += len;
+  }
+
+  for (size_t i = 0; i < CHECK_LEN; i++) {
+    uint32_t bits;
+    memcpy(&bits, &values[i], sizeof(bits));
+    hash = (hash ^ bits) * 1099511628211ull;
+    in_range &= values[i] >= -2.0f && values[i] < 3.0f;
+  }
+
+  free(values);
+  return in_range ? hash : 0;
+}
+
+static volatile float sink;
+
+static void bench() {
+  float *values = malloc(BENCH_LEN * sizeof(float));
+
+  uint64_t start = now_ns();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    for (int i = 0; i < BENCH_LEN; i++) {
+      values[i] = 10.0f * ((float)rand() / RAND_MAX);
+    }
+  }
+  double rand_ns = (double)(now_ns() - start) / ((double)BENCH_LEN * BENCH_ROUNDS);
+
+  start = now_ns();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    for (int i = 0; i < BENCH_LEN; i++) {
+      values[i] = random_float_range(0.0f, 10.0f);
+    }
+  }
+  double single_ns = (double)(now_ns() - start) / ((double)BENCH_LEN * BENCH_ROUNDS);
+
+  start = now_ns();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    random_floats(values, BENCH_LEN, 0.0f, 10.0f);
+  }
+  double bulk_ns = (double)(now_ns() - start) / ((double)BENCH_LEN * BENCH_ROUNDS);
+
+  sink = values[BENCH_LEN / 2];
+  printf("  rand() %.2f ns/float  random_float %.2f ns/float  random_floats %.2f ns/float\n", rand_ns, single_ns, bulk_ns);
+  free(values);
+}
+
+int main(int argc, char **argv) {
+  int failed = 0;
+  uint64_t reference = 0;
+
+  for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+    int fds[2];
+    if (pipe(fds) != 0) return 1;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      // simd_level() caches its first answer, so each level gets a fresh process
+      setenv("FIASCO_SIMD", levels[i], 1);
+      printf("%s (running %s)\n", levels[i], levels[simd_level()]);
+      uint64_t checksum = stream_checksum();
+      bench();
+      exit(write(fds[1], &checksum, sizeof(checksum)) == sizeof(checksum) ? 0 : 1);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    uint64_t checksum = 0;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || read(fds[0], &checksum, sizeof(checksum)) != sizeof(checksum)) {
+      failed = 1;
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    if (i == 0) reference = checksum;
+    bool ok = checksum != 0 && checksum == reference;
+    printf("  seed %d stream: %016llx  %s\n", SEED, (unsigned long long)checksum, ok ? "ok" : "MISMATCH");
+    failed |= !ok;
+  }
+
+  return failed;
+}
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fiasco.h>
+
+// Component id lookup bench: the old linear strcmp scan against the hashed
+// ComponentRegistry, for the lookups one thumb spawn used to make.
+
+#define NAMES 50
+#define ROUNDS 2000000
+
+static char *names[NAMES];
+static ComponentId linear_ids[NAMES];
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static ComponentId linear_find(const char *str) {
+  for (int i = 0; i < NAMES; i++) {
+    if (strcmp(names[i], str) == 0) return linear_ids[i];
+  }
+  return 0;
+}
+
+static volatile unsigned sink;
+
+int main() {
+  Arena arena = {0};
+  ComponentRegistry registry = {0};
+  registry.arena = &arena;
+  const char *engine_names[] = {
+    FiascoIds.Color, FiascoIds.Camera, FiascoIds.Transform, FiascoIds.Inputs,
+    FiascoIds.TextureRender, FiascoIds.ColorRender, FiascoIds.TextRender,
+    FiascoIds.CircleRender, FiascoIds.FrameConstants, FiascoIds.Aspect,
+    FiascoIds.EntityId, FiascoIds.GpuInterface, FiascoIds.MaterialManager,
+    FiascoIds.GpuResource, FiascoIds.GpuConfig
+  };
+  size_t engine_len = sizeof(engine_names) / sizeof(engine_names[0]);
+
+  // engine components first, then filler module components, "Thumb" last as
+  // the worst case for the scan
+  for (int i = 0; i < NAMES; i++) {
+    char buf[64];
+    if ((size_t)i < engine_len) snprintf(buf, sizeof(buf), "%s", engine_names[i]);
+    else if (i == NAMES - 1) snprintf(buf, sizeof(buf), "Thumb");
+    else snprintf(buf, sizeof(buf), "module::components::Filler%d", i);
+    names[i] = strdup(buf);
+    linear_ids[i] = (ComponentId)(i + 1);
+    registry_set(&registry, names[i], (ComponentId)(i + 1));
+  }
+
+  const char *spawn_lookups[] = {FiascoIds.Transform, "Thumb", FiascoIds.TextureRender, FiascoIds.Color};
+  unsigned acc = 0;
+
+  uint64_t start = now_ns();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int l = 0; l < 4; l++) acc += linear_find(spawn_lookups[l]);
+  }
+  double linear_ns = (double)(now_ns() - start) / ROUNDS;
+
+  start = now_ns();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int l = 0; l < 4; l++) acc += registry_find(&registry, spawn_lookups[l]);
+  }
+  double hashed_ns = (double)(now_ns() - start) / ROUNDS;
+
+  sink = acc;
+  printf("4 lookups per spawn over %d components\n", NAMES);
+  printf("  linear strcmp scan  %8.2f ns/spawn\n", linear_ns);
+  printf("  hashed registry     %8.2f ns/spawn\n", hashed_ns);
+
+  registry_clear(&registry);
+  arena_free(&arena);
+  return 0;
+}
@@ -33,7 +33,7 @@ function Compile {
     }
 
     Write-Host "Setting up MSVC environment..."
-    cmd.exe /c "`"$vcvarsall`" && cl /I src /LD $SourceFile /Fe$OutputFile"
+    cmd.exe /c "`"$vcvarsall`" && cl /O2 /I src /LD $SourceFile /Fe$OutputFile"
 
     if ($?) {
         Write-Host "Compilation successful: $OutputFile"
@@ -3,4 +3,4 @@ set -e
 
 OUTPUT_DIR="modules"
 mkdir -p $OUTPUT_DIR
-gcc -Wall -Werror -Isrc -shared -o $OUTPUT_DIR/sample-c.dylib src/*.c 
\ No newline at end of file
+gcc -Wall -Werror -O2 -fPIC -Isrc -shared -o $OUTPUT_DIR/sample-c.dylib src/*.c -lm -lpthread
\ No newline at end of file
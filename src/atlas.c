@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atlas.h>
+#include <png.h>
+#include <profiler.h>
+
+#ifdef _WIN32
+  #include <windows.h> // For FindFirstFile
+#else
+  #include <dirent.h>
+#endif
+
+#define ATLAS_PATH_MAX 4096
+#define ATLAS_INITIAL_CAP 64
+
+typedef struct {
+  char **items;
+  size_t len;
+  size_t cap;
+} NameList;
+
+static bool names_push(NameList *list, const char *name) {
+  if (list->len == list->cap) {
+    size_t cap = list->cap ? list->cap * 2 : ATLAS_INITIAL_CAP;
+    char **items = (char**)realloc(list->items, cap * sizeof(char*));
+    if (items == NULL) return false;
+    list->items = items;
+    list->cap = cap;
+  }
+  size_t len = strlen(name) + 1;
+  char *copy = (char*)malloc(len);
+  if (copy == NULL) return false;
+  memcpy(copy, name, len);
+  list->items[list->len++] = copy;
+  return true;
+}
+
+static void names_free(NameList *list) {
+  for (size_t i = 0; i < list->len; i++) free(list->items[i]);
+  free(list->items);
+  memset(list, 0, sizeof(NameList));
+}
+
+static bool png_name(const char *name) {
+  size_t len = strlen(name);
+  return len > 4 && (strcmp(name + len - 4, ".png") == 0 || strcmp(name + len - 4, ".PNG") == 0);
+}
+
+static int compare_names(const void *a, const void *b) {
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Sorted, so the same directory always packs the same way
+static bool list_pngs(const char *dir, NameList *list) {
+#ifdef _WIN32
+  char pattern[ATLAS_PATH_MAX];
+  snprintf(pattern, sizeof(pattern), "%s\\*.png", dir);
+  WIN32_FIND_DATAA found;
+  HANDLE find = FindFirstFileA(pattern, &found);
+  if (find == INVALID_HANDLE_VALUE) return GetLastError() == ERROR_FILE_NOT_FOUND;
+  bool ok = true;
+  do {
+    if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && png_name(found.cFileName)) {
+      ok = ok && names_push(list, found.cFileName);
+    }
+  } while (FindNextFileA(find, &found));
+  FindClose(find);
+#else
+  DIR *handle = opendir(dir);
+  if (handle == NULL) return false;
+  bool ok = true;
+  for (struct dirent *entry = readdir(handle); entry != NULL; entry = readdir(handle)) {
+    if (entry->d_name[0] != '.' && png_name(entry->d_name)) ok = ok && names_push(list, entry->d_name);
+  }
+  closedir(handle);
+#endif
+  if (list->len > 1) qsort(list->items, list->len, sizeof(char*), compare_names);
+  return ok;
+}
+
+// SKYLINE
+
+// The top edge of everything placed so far, as segments left to right
+typedef struct {
+  uint32_t x;
+  uint32_t y;
+  uint32_t w;
+} SkylineNode;
+
+typedef struct {
+  SkylineNode *nodes;
+  size_t len;
+} Skyline;
+
+static bool skyline_init(Skyline *sky, uint32_t size) {
+  // every segment is at least a pixel wide
+  sky->nodes = (SkylineNode*)malloc((size + 1) * sizeof(SkylineNode));
+  if (sky->nodes == NULL) return false;
+  sky->nodes[0] = (SkylineNode){0, 0, size};
+  sky->len = 1;
+  return true;
+}
+
+// The lowest y a w*h rect can rest at starting over node i, or false
+static bool skyline_fit(const Skyline *sky, size_t i, uint32_t w, uint32_t h, uint32_t size, uint32_t *y) {
+  if (sky->nodes[i].x + w > size) return false;
+  uint32_t top = 0;
+  for (uint32_t left = w; left > 0; i++) {
+    if (i == sky->len) return false;
+    if (sky->nodes[i].y > top) top = sky->nodes[i].y;
+    if (top + h > size) return false;
+    left -= sky->nodes[i].w < left ? sky->nodes[i].w : left;
+  }
+  *y = top;
+  return true;
+}
+
+// Bottom-left: the position with the lowest top edge, then the leftmost
+static bool skyline_find(const Skyline *sky, uint32_t w, uint32_t h, uint32_t size, size_t *index, uint32_t *y) {
+  uint32_t best_top = UINT32_MAX;
+  for (size_t i = 0; i < sky->len; i++) {
+    uint32_t top;
+    if (skyline_fit(sky, i, w, h, size, &top) && top + h < best_top) {
+      best_top = top + h;
+      *index = i;
+      *y = top;
+    }
+  }
+  return best_top != UINT32_MAX;
+}
+
+static void skyline_insert(Skyline *sky, size_t index, uint32_t w, uint32_t h, uint32_t y) {
+  SkylineNode placed = {sky->nodes[index].x, y + h, w};
+  memmove(&sky->nodes[index + 1], &sky->nodes[index], (sky->len - index) * sizeof(SkylineNode));
+  sky->nodes[index] = placed;
+  sky->len++;
+
+  // trim the segments the new one covers
+  for (size_t i = index + 1; i < sky->len;) {
+    SkylineNode *prev = &sky->nodes[i - 1];
+    SkylineNode *node = &sky->nodes[i];
+    uint32_t end = prev->x + prev->w;
+    if (node->x >= end) break;
+    uint32_t shrink = end - node->x;
+    if (node->w > shrink) {
+      node->x += shrink;
+      node->w -= shrink;
+      break;
+    }
+    memmove(node, node + 1, (sky->len - i - 1) * sizeof(SkylineNode));
+    sky->len--;
+  }
+
+  for (size_t i = 1; i < sky->len;) {
+    if (sky->nodes[i - 1].y == sky->nodes[i].y) {
+      sky->nodes[i - 1].w += sky->nodes[i].w;
+      memmove(&sky->nodes[i], &sky->nodes[i + 1], (sky->len - i - 1) * sizeof(SkylineNode));
+      sky->len--;
+    } else {
+      i++;
+    }
+  }
+}
+
+// BUILD
+
+typedef struct {
+  Image image;
+  uint32_t sheet;
+  uint32_t x, y; // of the padded rect
+  bool placed;
+} Packed;
+
+static const Packed *sort_packed;
+
+// Tallest first, then widest, then by name to stay deterministic
+static int compare_packed(const void *a, const void *b) {
+  const Packed *pa = &sort_packed[*(const uint32_t*)a];
+  const Packed *pb = &sort_packed[*(const uint32_t*)b];
+  if (pa->image.height != pb->image.height) return pa->image.height > pb->image.height ? -1 : 1;
+  if (pa->image.width != pb->image.width) return pa->image.width > pb->image.width ? -1 : 1;
+  return *(const uint32_t*)a < *(const uint32_t*)b ? -1 : 1;
+}
+
+// Copies the sprite into the sheet and repeats its edges into the padding
+static void blit(Image *sheet, const Image *sprite, uint32_t x, uint32_t y, uint32_t padding) {
+  uint32_t w = sprite->width, h = sprite->height;
+  for (uint32_t row = 0; row < h + 2 * padding; row++) {
+    uint32_t from = row < padding ? 0 : (row - padding >= h ? h - 1 : row - padding);
+    const uint8_t *src = sprite->pixels + (size_t)from * w * 4;
+    uint8_t *dst = sheet->pixels + ((size_t)(y + row) * sheet->width + x) * 4;
+    for (uint32_t p = 0; p < padding; p++) {
+      memcpy(dst + p * 4, src, 4);
+      memcpy(dst + (padding + w + p) * 4, src + (w - 1) * 4, 4);
+    }
+    memcpy(dst + padding * 4, src, (size_t)w * 4);
+  }
+}
+
+static size_t file_write(void *file, void *buf, size_t len) {
+  return fwrite(buf, 1, len, (FILE*)file);
+}
+
+static const char* base_name(const char *path) {
+  const char *slash = strrchr(path, '/');
+  const char *backslash = strrchr(path, '\\');
+  if (backslash != NULL && (slash == NULL || backslash > slash)) slash = backslash;
+  return slash != NULL ? slash + 1 : path;
+}
+
+static bool write_table(const char *path, const char *prefix, const NameList *names, const Packed *packed,
+                        size_t sheets, uint32_t size, uint32_t padding, size_t sprites) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) return false;
+
+  // sheet names are generated, sprite names are the listed ones
+  char sheet_name[ATLAS_PATH_MAX];
+  uint64_t names_len = 0;
+  for (size_t s = 0; s < sheets; s++) names_len += snprintf(sheet_name, sizeof(sheet_name), "%s-%zu.png", prefix, s) + 1;
+  for (size_t i = 0; i < names->len; i++) {
+    if (packed[i].placed) names_len += strlen(names->items[i]) + 1;
+  }
+
+  SnapshotWriter w;
+  snapshot_write_begin(&w, file, file_write);
+  snapshot_write_section(&w, ATLAS_ATLS, ATLAS_VERSION, 16);
+  snapshot_write_u32(&w, (uint32_t)sheets);
+  snapshot_write_u32(&w, (uint32_t)sprites);
+  snapshot_write_u32(&w, size);
+  snapshot_write_u32(&w, padding);
+  snapshot_write_section_end(&w);
+
+  snapshot_write_section(&w, ATLAS_NAME, ATLAS_VERSION, names_len);
+  for (size_t s = 0; s < sheets; s++) {
+    int len = snprintf(sheet_name, sizeof(sheet_name), "%s-%zu.png", prefix, s);
+    snapshot_write_bytes(&w, sheet_name, (size_t)len + 1);
+  }
+  for (size_t i = 0; i < names->len; i++) {
+    if (packed[i].placed) snapshot_write_bytes(&w, names->items[i], strlen(names->items[i]) + 1);
+  }
+  snapshot_write_section_end(&w);
+
+  uint32_t offset = 0;
+  snapshot_write_section(&w, ATLAS_SHTS, ATLAS_VERSION, (uint64_t)sheets * 4);
+  for (size_t s = 0; s < sheets; s++) {
+    snapshot_write_u32(&w, offset);
+    offset += (uint32_t)snprintf(sheet_name, sizeof(sheet_name), "%s-%zu.png", prefix, s) + 1;
+  }
+  snapshot_write_section_end(&w);
+
+  snapshot_write_section(&w, ATLAS_SPRS, ATLAS_VERSION, (uint64_t)sprites * ATLAS_SPRITE_BYTES);
+  for (size_t i = 0; i < names->len; i++) {
+    const Packed *p = &packed[i];
+    if (!p->placed) continue;
+    uint32_t x = p->x + padding, y = p->y + padding;
+    snapshot_write_u32(&w, offset);
+    snapshot_write_u32(&w, p->sheet);
+    snapshot_write_u32(&w, x);
+    snapshot_write_u32(&w, y);
+    snapshot_write_u32(&w, p->image.width);
+    snapshot_write_u32(&w, p->image.height);
+    float uv[4] = {(float)x / size, (float)y / size, (float)(x + p->image.width) / size,
+                   (float)(y + p->image.height) / size};
+    snapshot_write_f32s(&w, uv, 4);
+    offset += (uint32_t)strlen(names->items[i]) + 1;
+  }
+  snapshot_write_section_end(&w);
+
+  bool ok = snapshot_write_end(&w);
+  if (fclose(file) != 0) ok = false;
+  return ok;
+}
+
+bool atlas_build(const char *dir, const char *out_prefix, uint32_t sheet_size, uint32_t padding, AtlasStats *stats) {
+  memset(stats, 0, sizeof(AtlasStats));
+  uint64_t span = trace_begin();
+  NameList names = {0};
+  if (!list_pngs(dir, &names)) {
+    log_error("Could not list the sprites in %s", dir);
+    names_free(&names);
+    return false;
+  }
+
+  Packed *packed = (Packed*)calloc(names.len + 1, sizeof(Packed));
+  uint32_t *order = (uint32_t*)malloc((names.len + 1) * sizeof(uint32_t));
+  Skyline *skylines = NULL;
+  Image *sheets = NULL;
+  size_t sheets_len = 0, sheets_cap = 0;
+  bool ok = packed != NULL && order != NULL;
+
+  size_t readable = 0;
+  for (size_t i = 0; ok && i < names.len; i++) {
+    char path[ATLAS_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, names.items[i]);
+    if (png_read(path, &packed[i].image)) {
+      order[readable++] = (uint32_t)i;
+    } else {
+      log_warn("Skipping %s, it is not a PNG we can read", path);
+      stats->skipped++;
+    }
+  }
+  sort_packed = packed;
+  if (ok && readable > 1) qsort(order, readable, sizeof(uint32_t), compare_packed);
+
+  // first fit across sheets keeps the early ones dense
+  for (size_t o = 0; ok && o < readable; o++) {
+    Packed *p = &packed[order[o]];
+    uint32_t w = p->image.width + 2 * padding, h = p->image.height + 2 * padding;
+    if (w > sheet_size || h > sheet_size) {
+      log_warn("Skipping %s, %ux%u does not fit a %u sheet", names.items[order[o]], p->image.width,
+               p->image.height, sheet_size);
+      stats->skipped++;
+      continue;
+    }
+
+    size_t index = 0;
+    uint32_t y = 0;
+    size_t s = 0;
+    while (s < sheets_len && !skyline_find(&skylines[s], w, h, sheet_size, &index, &y)) s++;
+    if (s == sheets_len) {
+      if (sheets_len == sheets_cap) {
+        sheets_cap = sheets_cap ? sheets_cap * 2 : 4;
+        Skyline *grown = (Skyline*)realloc(skylines, sheets_cap * sizeof(Skyline));
+        if (grown != NULL) skylines = grown;
+        Image *grown_sheets = (Image*)realloc(sheets, sheets_cap * sizeof(Image));
+        if (grown_sheets != NULL) sheets = grown_sheets;
+        if (grown == NULL || grown_sheets == NULL) {
+          ok = false;
+          break;
+        }
+      }
+      memset(&sheets[s], 0, sizeof(Image));
+      if (!skyline_init(&skylines[s], sheet_size) || !image_alloc(&sheets[s], sheet_size, sheet_size)) {
+        free(skylines[s].nodes);
+        ok = false;
+        break;
+      }
+      sheets_len++;
+      skyline_find(&skylines[s], w, h, sheet_size, &index, &y);
+    }
+
+    p->sheet = (uint32_t)s;
+    p->x = skylines[s].nodes[index].x;
+    p->y = y;
+    p->placed = true;
+    skyline_insert(&skylines[s], index, w, h, y);
+    blit(&sheets[s], &p->image, p->x, p->y, padding);
+    stats->sprites++;
+    stats->sprite_pixels += (uint64_t)w * h;
+  }
+  stats->sheets = sheets_len;
+
+  for (size_t s = 0; ok && s < sheets_len; s++) {
+    char path[ATLAS_PATH_MAX];
+    snprintf(path, sizeof(path), "%s-%zu.png", out_prefix, s);
+    if (!png_write(path, &sheets[s])) {
+      log_error("Could not write the atlas sheet %s", path);
+      ok = false;
+    }
+  }
+
+  char table[ATLAS_PATH_MAX];
+  snprintf(table, sizeof(table), "%s.atlas", out_prefix);
+  if (ok && !write_table(table, base_name(out_prefix), &names, packed, sheets_len, sheet_size, padding,
+                         stats->sprites)) {
+    log_error("Could not write the atlas table %s", table);
+    ok = false;
+  }
+
+  for (size_t s = 0; s < sheets_len; s++) {
+    free(skylines[s].nodes);
+    image_free(&sheets[s]);
+  }
+  for (size_t i = 0; packed != NULL && i < names.len; i++) image_free(&packed[i].image);
+  free(skylines);
+  free(sheets);
+  free(order);
+  free(packed);
+  names_free(&names);
+  trace_end("atlas_build", "atlas", span);
+  return ok;
+}
+
+// LOAD
+
+static size_t slot_for(const Atlas *atlas, const char *name, uint32_t hash) {
+  size_t mask = atlas->slots_cap - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    uint32_t slot = atlas->slots[i];
+    if (slot == 0) return i;
+    const AtlasSprite *sprite = &atlas->sprites[slot - 1];
+    if (sprite->hash == hash && strcmp(sprite->name, name) == 0) return i;
+  }
+}
+
+static uint32_t get_u32(const uint8_t *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+bool atlas_load(Atlas *atlas, const char *path) {
+  memset(atlas, 0, sizeof(Atlas));
+  SnapshotMap map;
+  if (!snapshot_little_endian() || !snapshot_map(&map, path)) {
+    log_error("Could not open the atlas %s", path);
+    return false;
+  }
+
+  uint16_t version;
+  uint64_t atls_len, names_len, sheets_len, sprites_len;
+  const uint8_t *atls = snapshot_map_section(&map, ATLAS_ATLS, &version, &atls_len);
+  const uint8_t *names = snapshot_map_section(&map, ATLAS_NAME, &version, &names_len);
+  const uint8_t *sheets = snapshot_map_section(&map, ATLAS_SHTS, &version, &sheets_len);
+  const uint8_t *sprites = snapshot_map_section(&map, ATLAS_SPRS, &version, &sprites_len);
+
+  uint32_t sheet_count = atls != NULL && atls_len >= 16 ? get_u32(atls) : 0;
+  uint32_t sprite_count = atls != NULL && atls_len >= 16 ? get_u32(atls + 4) : 0;
+  bool ok = atls != NULL && names != NULL && sheets != NULL && sprites != NULL && names_len > 0 &&
+            names[names_len - 1] == '\0' && sheets_len >= (uint64_t)sheet_count * 4 &&
+            sprites_len >= (uint64_t)sprite_count * ATLAS_SPRITE_BYTES;
+
+  size_t slots_cap = 1;
+  while (slots_cap < (size_t)sprite_count * 2) slots_cap <<= 1;
+  if (ok) {
+    atlas->sheet_size = get_u32(atls + 8);
+    atlas->padding = get_u32(atls + 12);
+    atlas->names = (char*)malloc(names_len);
+    atlas->sheets = (const char**)calloc(sheet_count + 1, sizeof(char*));
+    atlas->sprites = (AtlasSprite*)calloc(sprite_count + 1, sizeof(AtlasSprite));
+    atlas->slots = (uint32_t*)calloc(slots_cap, sizeof(uint32_t));
+    atlas->slots_cap = slots_cap;
+    ok = atlas->names != NULL && atlas->sheets != NULL && atlas->sprites != NULL && atlas->slots != NULL;
+  }
+  if (ok) memcpy(atlas->names, names, names_len);
+
+  for (uint32_t s = 0; ok && s < sheet_count; s++) {
+    uint32_t offset = get_u32(sheets + 4 * s);
+    ok = offset < names_len;
+    if (ok) atlas->sheets[atlas->sheets_len++] = atlas->names + offset;
+  }
+
+  for (uint32_t i = 0; ok && i < sprite_count; i++) {
+    const uint8_t *record = sprites + (size_t)i * ATLAS_SPRITE_BYTES;
+    AtlasSprite *sprite = &atlas->sprites[i];
+    uint32_t offset = get_u32(record);
+    sprite->sheet = get_u32(record + 4);
+    ok = offset < names_len && sprite->sheet < sheet_count;
+    if (!ok) break;
+    sprite->name = atlas->names + offset;
+    sprite->hash = hash_string(sprite->name);
+    sprite->x = get_u32(record + 8);
+    sprite->y = get_u32(record + 12);
+    sprite->w = get_u32(record + 16);
+    sprite->h = get_u32(record + 20);
+    memcpy(sprite->uv, record + 24, sizeof(sprite->uv));
+    atlas->slots[slot_for(atlas, sprite->name, sprite->hash)] = i + 1;
+    atlas->sprites_len++;
+  }
+
+  snapshot_unmap(&map);
+  if (!ok) {
+    log_error("The atlas %s is damaged", path);
+    atlas_free(atlas);
+  }
+  return ok;
+}
+
+const AtlasSprite* atlas_find(const Atlas *atlas, const char *name) {
+  if (atlas->sprites_len == 0) return NULL;
+  uint32_t slot = atlas->slots[slot_for(atlas, name, hash_string(name))];
+  return slot == 0 ? NULL : &atlas->sprites[slot - 1];
+}
+
+void atlas_free(Atlas *atlas) {
+  free(atlas->names);
+  free(atlas->sheets);
+  free(atlas->sprites);
+  free(atlas->slots);
+  memset(atlas, 0, sizeof(Atlas));
+}
@@ -0,0 +1,63 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+#include <snapshot.h>
+
+// Sprite atlases packed offline. atlas_build packs every PNG in a directory
+// into square sheets with a skyline bottom-left packer and writes them next
+// to a UV table, so the runtime requests a few sheets instead of one texture
+// per sprite. The table is a snapshot stream:
+//   ATLS {sheet count, sprite count, sheet size, padding}
+//   NAME NUL-terminated names, sheets first
+//   SHTS per sheet {name offset}
+//   SPRS per sprite {name offset, sheet, x, y, w, h, u0, v0, u1, v1}
+// Sheet names are relative to the table, sprite names to the packed
+// directory. Padding around each sprite repeats its edge pixels so filtering
+// never samples a neighbour.
+
+#define ATLAS_ATLS SNAPSHOT_TAG('A', 'T', 'L', 'S')
+#define ATLAS_NAME SNAPSHOT_TAG('N', 'A', 'M', 'E')
+#define ATLAS_SHTS SNAPSHOT_TAG('S', 'H', 'T', 'S')
+#define ATLAS_SPRS SNAPSHOT_TAG('S', 'P', 'R', 'S')
+#define ATLAS_VERSION 1
+#define ATLAS_SPRITE_BYTES 40
+
+typedef struct {
+  const char *name;
+  uint32_t hash;
+  uint32_t sheet;
+  uint32_t x, y, w, h; // pixels, without the padding
+  float uv[4]; // u0, v0, u1, v1
+} AtlasSprite;
+
+typedef struct {
+  char *names;
+  const char **sheets;
+  size_t sheets_len;
+  AtlasSprite *sprites;
+  size_t sprites_len;
+  uint32_t *slots; // open-addressed, sprite index + 1, 0 when empty
+  size_t slots_cap;
+  uint32_t sheet_size;
+  uint32_t padding;
+} Atlas;
+
+typedef struct {
+  size_t sprites;
+  size_t sheets;
+  size_t skipped; // unreadable or larger than a sheet
+  uint64_t sprite_pixels; // padded area, to report occupancy against the sheets
+} AtlasStats;
+
+// Packs `dir`'s PNGs into `out_prefix`-N.png and `out_prefix`.atlas
+bool atlas_build(const char *dir, const char *out_prefix, uint32_t sheet_size, uint32_t padding, AtlasStats *stats);
+bool atlas_load(Atlas *atlas, const char *path);
+// NULL for names not in the atlas
+const AtlasSprite* atlas_find(const Atlas *atlas, const char *name);
+void atlas_free(Atlas *atlas);
+
+#endif
@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <autosave.h>
+#include <snapshot.h>
+#include <lz.h>
+
+#ifdef _WIN32
+  #include <windows.h> // For the worker thread
+#else
+  #include <pthread.h>
+#endif
+
+#define AUTOSAVE_FULL SNAPSHOT_TAG('F', 'U', 'L', 'L')
+#define AUTOSAVE_DELTA SNAPSHOT_TAG('D', 'L', 'T', 'A')
+#define AUTOSAVE_IDLE_MS 1
+
+typedef enum {
+  AutosaveStopped,
+  AutosaveRunning,
+  AutosaveStopping,
+  AutosaveSync // no worker could be started; saves run on the caller
+} AutosaveState;
+
+typedef struct {
+  const uint8_t *blob;
+  size_t len;
+  const uint8_t *base;
+  size_t base_len;
+  uint8_t header[AUTOSAVE_HEADER_MAX];
+  size_t header_len;
+} AutosaveJob;
+
+typedef struct {
+  char path[1024];
+  uint32_t compact_every;
+  uint32_t deltas; // since the last full save
+  volatile uint64_t busy;
+  volatile uint32_t state;
+  AutosaveJob job;
+  uint8_t *chunk; // one block of XOR delta
+  uint8_t *out; // the section payload being built
+  size_t out_cap;
+  AutosaveStats stats;
+#ifdef _WIN32
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+} Autosave;
+
+Autosave autosave;
+
+static size_t file_write(void *file, void *buf, size_t len) {
+  return fwrite(buf, 1, len, (FILE*)file);
+}
+
+static size_t file_read(void *file, void *buf, size_t len) {
+  return fread(buf, 1, len, (FILE*)file);
+}
+
+static bool out_reserve(size_t len) {
+  if (len <= autosave.out_cap) return true;
+  size_t cap = autosave.out_cap ? autosave.out_cap : SNAPSHOT_BLOCK;
+  while (cap < len) cap *= 2;
+  uint8_t *out = (uint8_t*)realloc(autosave.out, cap);
+  if (out == NULL) return false;
+  autosave.out = out;
+  autosave.out_cap = cap;
+  return true;
+}
+
+static void put_u32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+// Payload: u32 header length, header, u64 blob length, then per block
+// u32 raw length, u32 compressed length and the compressed bytes
+static size_t encode_job(const AutosaveJob *job, bool delta) {
+  size_t used = 4 + job->header_len + 8;
+  if (!out_reserve(used)) return 0;
+  put_u32(autosave.out, (uint32_t)job->header_len);
+  memcpy(autosave.out + 4, job->header, job->header_len);
+  put_u32(autosave.out + 4 + job->header_len, (uint32_t)job->len);
+  put_u32(autosave.out + 8 + job->header_len, (uint32_t)((uint64_t)job->len >> 32));
+
+  for (size_t at = 0; at < job->len; at += SNAPSHOT_BLOCK) {
+    size_t raw = job->len - at < SNAPSHOT_BLOCK ? job->len - at : SNAPSHOT_BLOCK;
+    const uint8_t *src = job->blob + at;
+    if (delta) {
+      for (size_t i = 0; i < raw; i++) autosave.chunk[i] = src[i] ^ job->base[at + i];
+      src = autosave.chunk;
+    }
+
+    if (!out_reserve(used + 8 + lz_bound(raw))) return 0;
+    size_t packed = lz_compress(src, raw, autosave.out + used + 8);
+    put_u32(autosave.out + used, (uint32_t)raw);
+    put_u32(autosave.out + used + 4, (uint32_t)packed);
+    used += 8 + packed;
+  }
+  return used;
+}
+
+static bool write_section(FILE *file, uint32_t tag, size_t len) {
+  SnapshotWriter w;
+  snapshot_write_open(&w, file, file_write);
+  snapshot_write_section(&w, tag, 1, len);
+  snapshot_write_bytes(&w, autosave.out, len);
+  snapshot_write_section_end(&w);
+  return snapshot_write_close(&w);
+}
+
+// Deltas are appended in place; a full save goes beside the file and is
+// renamed over it, so the file always replays to some complete save
+static bool run_job(const AutosaveJob *job) {
+  uint64_t start = clock_ns();
+  bool full = job->base == NULL || job->base_len != job->len || autosave.deltas >= autosave.compact_every;
+
+  size_t len = encode_job(job, !full);
+  if (len == 0) {
+    log_error("autosave: could not allocate %zu bytes", job->len);
+    return false;
+  }
+
+  char tmp[1040];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", autosave.path);
+  FILE *file = fopen(full ? tmp : autosave.path, full ? "wb" : "ab");
+  if (file == NULL) {
+    log_error("autosave: could not open %s", full ? tmp : autosave.path);
+    return false;
+  }
+
+  bool ok = true;
+  if (full) {
+    SnapshotWriter w;
+    snapshot_write_begin(&w, file, file_write);
+    ok = snapshot_write_close(&w);
+  }
+  ok = ok && write_section(file, full ? AUTOSAVE_FULL : AUTOSAVE_DELTA, len);
+  ok = fclose(file) == 0 && ok;
+  if (full && ok) {
+#ifdef _WIN32
+    remove(autosave.path); // rename does not replace on Windows
+#endif
+    ok = rename(tmp, autosave.path) == 0;
+  }
+  if (!ok) {
+    log_error("autosave: writing %s failed", autosave.path);
+    return false;
+  }
+
+  autosave.deltas = full ? 0 : autosave.deltas + 1;
+  autosave.stats.saves++;
+  autosave.stats.fulls += full ? 1 : 0;
+  autosave.stats.raw_bytes = job->len;
+  autosave.stats.written_bytes = len;
+  autosave.stats.ms = (clock_ns() - start) / 1e6;
+  log_debug("autosave: %s %zu -> %zu bytes in %.1f ms", full ? "full" : "delta", job->len, len, autosave.stats.ms);
+  return true;
+}
+
+static void autosave_run() {
+  for (;;) {
+    if (atomic_load_u64(&autosave.busy)) {
+      run_job(&autosave.job);
+      atomic_store_u64(&autosave.busy, 0);
+      continue;
+    }
+    if (autosave.state == AutosaveStopping) break;
+    sleep_ms(AUTOSAVE_IDLE_MS);
+  }
+}
+
+#ifdef _WIN32
+DWORD WINAPI autosave_main(LPVOID arg) {
+  autosave_run();
+  return 0;
+}
+#else
+void* autosave_main(void *arg) {
+  autosave_run();
+  return NULL;
+}
+#endif
+
+bool autosave_start(const char *path, uint32_t compact_every) {
+  if (autosave.state != AutosaveStopped) return false;
+
+  autosave.chunk = (uint8_t*)malloc(SNAPSHOT_BLOCK);
+  if (autosave.chunk == NULL || strlen(path) >= sizeof(autosave.path)) {
+    free(autosave.chunk);
+    autosave.chunk = NULL;
+    return false;
+  }
+  strcpy(autosave.path, path);
+  autosave.compact_every = compact_every;
+  autosave.deltas = 0;
+  memset(&autosave.stats, 0, sizeof(AutosaveStats));
+
+#ifdef _WIN32
+  autosave.thread = CreateThread(NULL, 0, autosave_main, NULL, 0, NULL);
+  bool started = autosave.thread != NULL;
+#else
+  bool started = pthread_create(&autosave.thread, NULL, autosave_main, NULL) == 0;
+#endif
+  autosave.state = started ? AutosaveRunning : AutosaveSync;
+  if (!started) log_warn("autosave: no worker thread, saves will stall the frame");
+  return true;
+}
+
+bool autosave_busy() {
+  return atomic_load_u64(&autosave.busy) != 0;
+}
+
+bool autosave_submit(const void *blob, size_t len, const void *base, size_t base_len, const void *header,
+                     size_t header_len) {
+  if (autosave.state == AutosaveStopped || autosave_busy() || header_len > AUTOSAVE_HEADER_MAX) return false;
+
+  autosave.job.blob = (const uint8_t*)blob;
+  autosave.job.len = len;
+  autosave.job.base = (const uint8_t*)base;
+  autosave.job.base_len = base_len;
+  memcpy(autosave.job.header, header, header_len);
+  autosave.job.header_len = header_len;
+
+  if (autosave.state == AutosaveSync) return run_job(&autosave.job);
+  atomic_store_u64(&autosave.busy, 1);
+  return true;
+}
+
+void autosave_wait() {
+  while (autosave.state == AutosaveRunning && autosave_busy()) sleep_ms(AUTOSAVE_IDLE_MS);
+}
+
+void autosave_stop() {
+  if (autosave.state == AutosaveStopped) return;
+  autosave_wait();
+
+  if (autosave.state == AutosaveRunning) {
+    autosave.state = AutosaveStopping;
+#ifdef _WIN32
+    WaitForSingleObject(autosave.thread, INFINITE);
+    CloseHandle(autosave.thread);
+#else
+    pthread_join(autosave.thread, NULL);
+#endif
+  }
+
+  free(autosave.chunk);
+  free(autosave.out);
+  autosave.chunk = NULL;
+  autosave.out = NULL;
+  autosave.out_cap = 0;
+  autosave.state = AutosaveStopped;
+}
+
+AutosaveStats autosave_stats() {
+  autosave_wait();
+  return autosave.stats;
+}
+
+// LOADING
+
+// Decodes one section's blocks into `out`, which holds `len` bytes
+static bool decode_blocks(SnapshotReader *r, uint8_t *out, size_t len, uint8_t *packed) {
+  for (size_t at = 0; at < len; at += SNAPSHOT_BLOCK) {
+    uint32_t raw, size;
+    if (!snapshot_read_u32(r, &raw) || !snapshot_read_u32(r, &size)) return false;
+    if (raw != (len - at < SNAPSHOT_BLOCK ? len - at : SNAPSHOT_BLOCK) || size > lz_bound(SNAPSHOT_BLOCK)) return false;
+    if (!snapshot_read_bytes(r, packed, size) || !lz_decompress(packed, size, out + at, raw)) return false;
+  }
+  return true;
+}
+
+bool autosave_load(const char *path, uint8_t **blob, size_t *len, void *header, size_t header_len) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return false;
+
+  *blob = NULL;
+  *len = 0;
+  uint8_t *next = NULL;
+  uint8_t *packed = (uint8_t*)malloc(lz_bound(SNAPSHOT_BLOCK));
+  uint8_t *section_header = (uint8_t*)malloc(header_len);
+  size_t sections = 0;
+
+  SnapshotReader r;
+  uint32_t tag;
+  uint16_t version;
+  uint64_t length;
+  snapshot_read_begin(&r, file, file_read);
+  while (packed != NULL && section_header != NULL && snapshot_read_section(&r, &tag, &version, &length)) {
+    if (tag != AUTOSAVE_FULL && tag != AUTOSAVE_DELTA) {
+      snapshot_read_section_end(&r);
+      continue;
+    }
+
+    uint32_t saved_header_len, len_lo, len_hi;
+    snapshot_read_u32(&r, &saved_header_len);
+    if (r.failed || saved_header_len != header_len || !snapshot_read_bytes(&r, section_header, header_len)) break;
+    if (!snapshot_read_u32(&r, &len_lo) || !snapshot_read_u32(&r, &len_hi)) break;
+    size_t next_len = (size_t)((uint64_t)len_hi << 32 | len_lo);
+    if (tag == AUTOSAVE_DELTA && (*blob == NULL || next_len != *len)) break;
+
+    // decoded aside, and applied only once the section's crc checks out
+    uint8_t *grown = (uint8_t*)realloc(next, next_len > 0 ? next_len : 1);
+    if (grown == NULL) break;
+    next = grown;
+    if (!decode_blocks(&r, next, next_len, packed) || !snapshot_read_section_end(&r)) break;
+
+    if (tag == AUTOSAVE_FULL) {
+      uint8_t *swap = *blob;
+      *blob = next;
+      next = swap;
+      *len = next_len;
+    } else {
+      for (size_t i = 0; i < next_len; i++) (*blob)[i] ^= next[i];
+    }
+    memcpy(header, section_header, header_len);
+    sections++;
+  }
+
+  if (r.failed && !r.eof) {
+    log_warn("autosave: %s is damaged after %zu good sections, keeping those", path, sections);
+  }
+  snapshot_read_end(&r);
+  fclose(file);
+  free(next);
+  free(packed);
+  free(section_header);
+  return *blob != NULL;
+}
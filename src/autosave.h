@@ -0,0 +1,42 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+
+// Background autosave. The game hands over a finished capture, one flat blob
+// plus a small header, and keeps playing. A worker thread XORs the blob with
+// the previous save's, LZ-compresses the result a SNAPSHOT_BLOCK at a time
+// and appends it to the file as a DLTA section. Every `compact_every` deltas,
+// and whenever the blob changes size, the file is instead rewritten as a
+// single FULL section. Neither blob may change until autosave_busy() is
+// false again.
+
+#define AUTOSAVE_HEADER_MAX 256
+
+typedef struct {
+  uint64_t saves;
+  uint64_t fulls;
+  uint64_t raw_bytes; // of the last save
+  uint64_t written_bytes; // of the last save
+  double ms; // the worker spent on the last save
+} AutosaveStats;
+
+bool autosave_start(const char *path, uint32_t compact_every);
+bool autosave_busy();
+// False while the last save is still in flight. `base` is the blob of the
+// previous save, or NULL to force a full one.
+bool autosave_submit(const void *blob, size_t len, const void *base, size_t base_len, const void *header,
+                     size_t header_len);
+void autosave_wait();
+// Waits for the save in flight and joins the worker
+void autosave_stop();
+// As of the last finished save
+AutosaveStats autosave_stats();
+// Replays the file into a malloc'd `blob` and `header`. A damaged or torn
+// section ends the replay at the last good state.
+bool autosave_load(const char *path, uint8_t **blob, size_t *len, void *header, size_t header_len);
+
+#endif
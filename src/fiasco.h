@@ -2,6 +2,7 @@
 #define FIASCO_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <stdalign.h>
 
@@ -18,11 +19,172 @@
   #define EXPORT
 #endif
 
+#ifdef _MSC_VER
+  #include <intrin.h>
+  #define THREAD_LOCAL __declspec(thread)
+#else
+  #define THREAD_LOCAL _Thread_local
+#endif
+
+// Minimal atomics that build on both gcc/clang and msvc. Add returns the new value.
+static inline bool atomic_cas_ptr(void *volatile *ptr, void *expected, void *desired) {
+#ifdef _MSC_VER
+  return _InterlockedCompareExchangePointer(ptr, desired, expected) == expected;
+#else
+  return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline bool atomic_cas_u64(volatile uint64_t *ptr, uint64_t expected, uint64_t desired) {
+#ifdef _MSC_VER
+  return (uint64_t)_InterlockedCompareExchange64((volatile long long*)ptr, (long long)desired, (long long)expected) == expected;
+#else
+  return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void* atomic_load_ptr(void *volatile *ptr) {
+#ifdef _MSC_VER
+  return _InterlockedCompareExchangePointer(ptr, NULL, NULL);
+#else
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline uint64_t atomic_add_u64(volatile uint64_t *ptr, uint64_t value) {
+#ifdef _MSC_VER
+  return (uint64_t)_InterlockedExchangeAdd64((volatile long long*)ptr, (long long)value) + value;
+#else
+  return __atomic_add_fetch(ptr, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static inline uint32_t atomic_add_u32(volatile uint32_t *ptr, uint32_t value) {
+#ifdef _MSC_VER
+  return (uint32_t)_InterlockedExchangeAdd((volatile long*)ptr, (long)value) + value;
+#else
+  return __atomic_add_fetch(ptr, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static inline bool atomic_cas_u32(volatile uint32_t *ptr, uint32_t expected, uint32_t desired) {
+#ifdef _MSC_VER
+  return (uint32_t)_InterlockedCompareExchange((volatile long*)ptr, (long)desired, (long)expected) == expected;
+#else
+  return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline uint64_t atomic_load_u64(volatile uint64_t *ptr) {
+#ifdef _MSC_VER
+  return (uint64_t)_InterlockedCompareExchange64((volatile long long*)ptr, 0, 0);
+#else
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void atomic_store_u64(volatile uint64_t *ptr, uint64_t value) {
+#ifdef _MSC_VER
+  _InterlockedExchange64((volatile long long*)ptr, (long long)value);
+#else
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+// LOGGING
+
+// Levels below FIASCO_LOG_LEVEL (0 trace .. 4 error) compile out; the default
+// drops trace, which is all the per-export load chatter. FIASCO_LOG=trace|
+// debug|info|warn|error|off raises the run-time level (info by default).
+#ifndef FIASCO_LOG_LEVEL
+  #define FIASCO_LOG_LEVEL 1
+#endif
+
+typedef enum {
+  LogTrace,
+  LogDebug,
+  LogInfo,
+  LogWarn,
+  LogError,
+  LogOff
+} LogLevel;
+
+extern volatile int log_runtime_level;
+
+// Copies the format and its arguments into a lock-free ring; a background
+// thread formats them and writes to stdout. `format` must outlive the call,
+// as a literal does. Never blocks: if the ring is full the message is counted
+// and dropped.
+void log_write(LogLevel level, const char *format, ...)
+#if defined(__GNUC__) || defined(__clang__)
+  __attribute__((format(printf, 2, 3)))
+#endif
+  ;
+void log_set_level(LogLevel level);
+// Waits until everything logged before the call has been written
+void log_flush();
+// Flushes and joins the drain thread; the next message starts it again
+void log_stop();
+
+void sleep_ms(unsigned ms);
+// Monotonic, for measuring intervals
+uint64_t clock_ns();
+
+#define LOG_AT(level, ...) ((int)(level) >= log_runtime_level ? log_write(level, __VA_ARGS__) : (void)0)
+
+#if FIASCO_LOG_LEVEL <= 0
+  #define log_trace(...) LOG_AT(LogTrace, __VA_ARGS__)
+#else
+  #define log_trace(...) ((void)0)
+#endif
+#if FIASCO_LOG_LEVEL <= 1
+  #define log_debug(...) LOG_AT(LogDebug, __VA_ARGS__)
+#else
+  #define log_debug(...) ((void)0)
+#endif
+#if FIASCO_LOG_LEVEL <= 2
+  #define log_info(...) LOG_AT(LogInfo, __VA_ARGS__)
+#else
+  #define log_info(...) ((void)0)
+#endif
+#if FIASCO_LOG_LEVEL <= 3
+  #define log_warn(...) LOG_AT(LogWarn, __VA_ARGS__)
+#else
+  #define log_warn(...) ((void)0)
+#endif
+#define log_error(...) LOG_AT(LogError, __VA_ARGS__)
+
 #define CURSOR_OFFSET 196
 #define WHEEL_OFFSET 204
 #define MOUSE_OFFSET 212
 
-char* current_dir();
+typedef struct ArenaBlock ArenaBlock;
+
+// Bump allocator. Allocations are only released all at once by
+// `arena_reset`/`arena_free`; not thread-safe.
+typedef struct {
+  ArenaBlock *blocks;
+  size_t block_size;
+  size_t used;
+  size_t high_water;
+  size_t reserved;
+  size_t block_count;
+} Arena;
+
+typedef struct {
+  size_t used;
+  size_t high_water;
+  size_t reserved;
+  size_t blocks;
+} ArenaStats;
+
+void* arena_alloc(Arena *arena, size_t size, size_t align);
+char* arena_strdup(Arena *arena, const char *str);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+ArenaStats arena_stats(const Arena *arena);
+char* current_dir(Arena *arena);
+char* asset_path(Arena *arena, const char *relative);
 
 typedef enum {
   PendingType,
@@ -309,13 +471,86 @@ typedef struct {
   char* GpuConfig;
 } FiascoIds_t;
 
-const FiascoIds_t FiascoIds;
+extern const FiascoIds_t FiascoIds;
+
+// FiascoIds resolved to the ComponentIds the engine assigned this session
+typedef struct {
+  ComponentId Color;
+  ComponentId Camera;
+  ComponentId Transform;
+  ComponentId Inputs;
+  ComponentId TextureRender;
+  ComponentId ColorRender;
+  ComponentId TextRender;
+  ComponentId CircleRender;
+  ComponentId FrameConstants;
+  ComponentId Aspect;
+  ComponentId EntityId;
+  ComponentId GpuInterface;
+  ComponentId MaterialManager;
+  ComponentId GpuResource;
+  ComponentId GpuConfig;
+} FiascoComponentIds_t;
+
+typedef struct {
+  uint32_t hash;
+  ComponentId id;
+  const char *key;
+} RegistrySlot;
+
+// Open-addressed string -> ComponentId map. Keys and slot tables live in
+// `arena`, so a lookup is one hash plus, almost always, one strcmp.
+typedef struct {
+  RegistrySlot *slots;
+  size_t cap;
+  size_t len;
+  Arena *arena;
+} ComponentRegistry;
+
+typedef struct CommandSegment CommandSegment;
+
+// Deferred spawn/despawn commands. Each recording thread appends to its own
+// segment (registered once with a lock-free push), so systems running under
+// query_par_for_each can record without locks. `command_buffer_flush` must run
+// while nothing is recording, e.g. from a system of its own.
+typedef struct {
+  CommandSegment *segments;
+  volatile uint64_t epoch;
+  size_t spawned;
+  size_t despawned;
+} CommandBuffer;
 
 typedef struct {
   char* NewTexture;
 } FiascoEvents_t;
 
-const FiascoEvents_t FiascoEvents;
+extern const FiascoEvents_t FiascoEvents;
+
+#define MAX_SYSTEM_ARGS 8
+#define MAX_QUERY_COMPONENTS 8
+
+// Ids are held through a pointer to the id string (e.g. &FiascoIds.Aspect) so
+// a descriptor table can be a static initializer.
+typedef struct {
+  char *const *id;
+  ArgType access; // DataAccessRef or DataAccessMut
+} QueryComponent;
+
+// `id` names the resource or event; queries leave it NULL and list components
+typedef struct {
+  ArgType type;
+  char *const *id;
+  size_t query_len;
+  QueryComponent query[MAX_QUERY_COMPONENTS];
+} SystemArg;
+
+typedef struct {
+  const char *name;
+  system_func fn;
+  bool once;
+  size_t args_len;
+  SystemArg args[MAX_SYSTEM_ARGS];
+} SystemDesc;
 
 typedef struct {
   float x, y, width, height;
@@ -548,14 +783,60 @@ typedef enum {
   F35 = 193
 } KeyCode;
 
+// Bits for every KeyCode, rounded up to whole 32-byte SIMD steps
+#define INPUT_KEYS (F35 + 1)
+#define INPUT_WORDS 4
+
+// One frame of input, decoded once by input_decode. Each bitset has a bit per
+// KeyCode; `edges` lists the keys pressed or released this frame, in KeyCode
+// order. With `idle` set, no key or mouse button is down or was just released
+// and the wheel is still; only the cursor may have moved.
+typedef struct {
+  uint64_t pressed[INPUT_WORDS];
+  uint64_t held[INPUT_WORDS];
+  uint64_t just_pressed[INPUT_WORDS];
+  uint64_t just_released[INPUT_WORDS];
+  uint8_t edges[INPUT_KEYS];
+  size_t edges_len;
+  MouseState mouse;
+  Vec2 wheel;
+  bool idle;
+} InputFrame;
+
+static inline bool input_bit(const uint64_t *bits, KeyCode code) {
+  return (bits[code >> 6] >> (code & 63)) & 1;
+}
+
+typedef enum {
+  SimdScalar,
+  SimdSse2,
+  SimdAvx2
+} SimdLevel;
+
+SimdLevel simd_level();
+uint32_t hash_string(const char *str);
+bool registry_set(ComponentRegistry *registry, const char *string_id, ComponentId id);
+ComponentId registry_find(const ComponentRegistry *registry, const char *string_id);
+void registry_clear(ComponentRegistry *registry);
+void resolve_fiasco_ids(const ComponentRegistry *registry, FiascoComponentIds_t *ids);
+bool validate_systems(const SystemDesc *systems, size_t len);
+bool command_spawn(CommandBuffer *buffer, const ComponentRef *refs, size_t count, EntityId *result);
+bool command_despawn(CommandBuffer *buffer, EntityId entity);
+size_t command_buffer_flush(CommandBuffer *buffer, spawn_t spawn, despawn_t despawn);
+void command_buffer_free(CommandBuffer *buffer);
 HSVA rgb_to_hsv(Color rgb);
 Color hsv_to_rgb(HSVA hsv);
+void rgb_to_hsv_batch(const Color *rgb, HSVA *hsv, size_t len);
+void hsv_to_rgb_batch(const HSVA *hsv, Color *rgb, size_t len);
 const int make_api_version(int major, int minor, int patch);
 const float random_float_range(float min, float max);
 const float random_float();
+void random_floats(float *out, size_t len, float min, float max);
+void random_seed(uint64_t seed);
 ButtonState key(KeyCode code, void *ptr);
 MouseState mouse(void *ptr);
 Vec2 wheel(void *ptr);
+void input_decode(InputFrame *frame, const void *ptr);
 Vec2 mouse_to_screen(MouseState mouse, const Aspect *aspect);
 Screen aspect_to_screen(const Aspect *aspect);
 void convert_string_to_uint8(const char *input, uint8_t output[256]);
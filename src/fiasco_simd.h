@@ -0,0 +1,58 @@
+#ifndef FIASCO_SIMD_H
+#define FIASCO_SIMD_H
+
+#include <fiasco.h>
+
+// Shared helpers for the SIMD kernels. Only x86 gets vector paths; everything
+// else runs the scalar versions, which use the same formulas.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define FIASCO_X86
+  #include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+  #define TARGET_AVX2
+#endif
+
+// Branch-free hsv -> rgb: channel n is v - v*s*clamp(min(k, 4 - k), 0, 1)
+// with k = (n + h/60) mod 6, n = 5, 3, 1 for r, g, b. Valid for h in [0, 360).
+static inline float hue_channel(float n, float h, float s, float v) {
+  float k = n + h * (1.0f / 60.0f);
+  k = k >= 6.0f ? k - 6.0f : k;
+  float w = k < 4.0f - k ? k : 4.0f - k;
+  w = w < 1.0f ? w : 1.0f;
+  w = w > 0.0f ? w : 0.0f;
+  return v - v * s * w;
+}
+
+#ifdef FIASCO_X86
+
+static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// `sv` is s * v, shared by all three channels
+static inline __m128 hue_channel_sse2(__m128 n, __m128 h, __m128 sv, __m128 v) {
+  const __m128 six = _mm_set1_ps(6.0f);
+  __m128 k = _mm_add_ps(n, _mm_mul_ps(h, _mm_set1_ps(1.0f / 60.0f)));
+  k = _mm_sub_ps(k, _mm_and_ps(_mm_cmpge_ps(k, six), six));
+  __m128 w = _mm_min_ps(_mm_min_ps(k, _mm_sub_ps(_mm_set1_ps(4.0f), k)), _mm_set1_ps(1.0f));
+  w = _mm_max_ps(w, _mm_setzero_ps());
+  return _mm_sub_ps(v, _mm_mul_ps(sv, w));
+}
+
+TARGET_AVX2 static inline __m256 hue_channel_avx2(__m256 n, __m256 h, __m256 sv, __m256 v) {
+  const __m256 six = _mm256_set1_ps(6.0f);
+  __m256 k = _mm256_add_ps(n, _mm256_mul_ps(h, _mm256_set1_ps(1.0f / 60.0f)));
+  k = _mm256_sub_ps(k, _mm256_and_ps(_mm256_cmp_ps(k, six, _CMP_GE_OQ), six));
+  __m256 w = _mm256_min_ps(_mm256_min_ps(k, _mm256_sub_ps(_mm256_set1_ps(4.0f), k)), _mm256_set1_ps(1.0f));
+  w = _mm256_max_ps(w, _mm256_setzero_ps());
+  return _mm256_sub_ps(v, _mm256_mul_ps(sv, w));
+}
+
+#endif
+
+#endif
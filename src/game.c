@@ -4,82 +4,105 @@
 #include <stdlib.h>
 #include <stdalign.h> 
 #include <string.h>
+#include <time.h>
 #include <fiasco.h>
+#include <thumb_soa.h>
+#include <profiler.h>
+#include <snapshot.h>
+#include <autosave.h>
+#include <replay.h>
+#include <textures.h>
+#include <spatial_grid.h>
 
-#define MAX_IDS 50
 #define INITIAL_THUMBS 5
+#define THUMB_BURST 1000
+#define THUMB_POOL_CAPACITY 16384
 #define CAMERA_MOVE_SCALE 300
 
 const char *thumb_path = "/assets/thumb.png";
+// Textures loaded at startup alongside the thumb; FIASCO_TEXTURES overrides it
+const char *texture_manifest = "assets/textures.txt";
 
 const char engine_version[3] = {0, 0, 20};
 
-char **component_id_strs[MAX_IDS];
-ComponentId component_ids[MAX_IDS];
+// Registration data lives for the whole session; the frame arena is reset by
+// flush_commands at the end of every frame.
+Arena persistent_arena;
+Arena frame_arena;
+ComponentRegistry component_registry = {.arena = &persistent_arena};
+FiascoComponentIds_t fiasco_ids;
+ComponentId thumb_id;
 Engine engine;
+ThumbSoa thumb_soa;
+ThumbMotion thumb_motion;
+CommandBuffer commands;
+TextureCache texture_cache = {.arena = &persistent_arena, .engine = &engine};
 
 const ComponentId find_id(char* str) {
-  for (int i = 0; i < MAX_IDS; i++) {
-    if (component_id_strs[i] == NULL) {
-      break;
-    }
-    if (strcmp(*component_id_strs[i], str) == 0) {
-      return component_ids[i];
-    }
-  }
-  return 0;
+  return registry_find(&component_registry, str);
 }
 
 // COMPONENTS
 
 char *THUMB_ID = "Thumb";
 
+#define THUMB_VERSION 2
+#define HUE_SPEED 100
+
+// Heading is a unit vector and color is kept as hsv, so a frame needs no trig
+// and no color-space conversion. `hue` is the hue when the hue clock reads
+// zero; thumb_color adds the clock.
 typedef struct {
-  float angle;
+  Vec2 direction;
   float speed;
+  float hue;
+  float saturation;
+  float value;
 } Thumb;
 
-// END COMPONENTS
+// Seconds into the current hue cycle. Only thumb_color advances it, so the
+// color pass never has to write Thumb.
+float hue_clock = 0;
 
-EntityId spawn_camera() {
-  Camera camera;
-  memset(&camera, 0, sizeof(Camera));
+float hue_offset() {
+  return hue_clock * HUE_SPEED;
+}
 
-  camera.is_enabled = true;
-  camera.viewport_ratio.height = 1;
-  camera.viewport_ratio.width = 1;
-  camera.orthographic_size = 1;
-  camera.clear_color = (Color){0.15, .345, .5568, 1}; // it's like a blue
+// END COMPONENTS
 
-  ComponentRef cam_ref;
-  cam_ref.component_id = find_id(FiascoIds.Camera);
-  cam_ref.component_size = sizeof(camera);
-  cam_ref.component_val = &camera;
+void init_camera(Camera *camera, Transform *transform) {
+  memset(camera, 0, sizeof(Camera));
 
-  Transform transform;
-  memset(&transform, 0, sizeof(Transform));
+  camera->is_enabled = true;
+  camera->viewport_ratio.height = 1;
+  camera->viewport_ratio.width = 1;
+  camera->orthographic_size = 1;
+  camera->clear_color = (Color){0.15, .345, .5568, 1}; // it's like a blue
 
-  transform.scale.x = 1;
-  transform.scale.y = 1;
+  memset(transform, 0, sizeof(Transform));
 
-  ComponentRef transform_ref;
-  transform_ref.component_id = find_id(FiascoIds.Transform);
-  transform_ref.component_size = sizeof(transform);
-  transform_ref.component_val = &transform;
+  transform->scale.x = 1;
+  transform->scale.y = 1;
+}
 
-  ComponentRef *bundle = (ComponentRef*)malloc(2 * sizeof(ComponentRef));
-  bundle[0] = cam_ref;
-  bundle[1] = transform_ref;
+bool spawn_camera(Camera *camera, Transform *transform) {
+  ComponentRef cam_ref;
+  cam_ref.component_id = fiasco_ids.Camera;
+  cam_ref.component_size = sizeof(Camera);
+  cam_ref.component_val = camera;
 
-  EntityId entity_id = engine.spawn(bundle, 2);
+  ComponentRef transform_ref;
+  transform_ref.component_id = fiasco_ids.Transform;
+  transform_ref.component_size = sizeof(Transform);
+  transform_ref.component_val = transform;
 
-  free(bundle);
-  return entity_id;
+  ComponentRef bundle[2] = {cam_ref, transform_ref};
+  return command_spawn(&commands, bundle, 2, NULL);
 }
 
-const char *text = "Controls\nMove Camera: W/A/S/D\nZoom Camera: -/+\nRotate Camera: Q/E\nSpawn: Left Click";
+const char *text = "Controls\nMove Camera: W/A/S/D\nZoom Camera: -/+\nRotate Camera: Q/E\nSpawn: Left Click\nBurst Spawn: Space\nCapture: F5\nLoad Autosave: F9";
 
-EntityId spawn_text() {
+bool spawn_text() {
   TextRender text_render;
   text_render.font_size = 42;
   text_render.visible = true;
@@ -87,7 +110,7 @@ EntityId spawn_text() {
   convert_string_to_uint8(text, text_render.text);
 
   ComponentRef text_render_ref;
-  text_render_ref.component_id = find_id(FiascoIds.TextRender);
+  text_render_ref.component_id = fiasco_ids.TextRender;
   text_render_ref.component_size = sizeof(TextRender);
   text_render_ref.component_val = &text_render;
 
@@ -97,185 +120,1112 @@ EntityId spawn_text() {
   transform.scale.y = 1;
 
   ComponentRef transform_ref;
-  transform_ref.component_id = find_id(FiascoIds.Transform);
+  transform_ref.component_id = fiasco_ids.Transform;
   transform_ref.component_size = sizeof(transform);
   transform_ref.component_val = &transform;
 
-  const uint8_t count = 2;
-  ComponentRef *bundle = (ComponentRef*)malloc(count * sizeof(ComponentRef));
-  bundle[0] = text_render_ref;
-  bundle[1] = transform_ref;
-
-  EntityId entity_id = engine.spawn(bundle, count);
-
-  free(bundle);
-  return entity_id;
+  ComponentRef bundle[2] = {text_render_ref, transform_ref};
+  return command_spawn(&commands, bundle, 2, NULL);
 }
 
-EntityId spawn_thumb(Vec2 *vec, TextureId thumb_texture_id) {
-  Transform transform;
-  memset(&transform, 0, sizeof(Transform));
-
-  float scale = random_float_range(30, 60);
-  transform.position.x = vec->x;
-  transform.position.y = vec->y;
-  transform.scale.x = scale;
-  transform.scale.y = scale;
-  transform.rotation = random_float_range(0, 6);
+// Gives a thumb a fresh random size, spin, heading, speed and color at `vec`
+void roll_thumb(Vec2 *vec, Transform *transform, Thumb *thumb, Color *color) {
+  // scale, rotation, heading, speed, r, g, b
+  float draws[7];
+  random_floats(draws, 7, 0.0f, 1.0f);
+
+  float scale = 30 + 30 * draws[0];
+  transform->position.x = vec->x;
+  transform->position.y = vec->y;
+  transform->scale.x = scale;
+  transform->scale.y = scale;
+  transform->rotation = 6 * draws[1];
+
+  float angle = 6 * draws[2];
+  thumb->direction.x = cosf(angle);
+  thumb->direction.y = sinf(angle);
+  thumb->speed = 100 + 900 * draws[3];
+
+  color->r = draws[4];
+  color->g = draws[5];
+  color->b = draws[6];
+  color->a = 1.0f;
+
+  // stored as a phase so the color system shows exactly this hue right now
+  HSVA hsv = rgb_to_hsv(*color);
+  thumb->hue = fmodf(hsv.h - hue_offset() + 2 * HUE_WRAP, HUE_WRAP);
+  thumb->saturation = hsv.s;
+  thumb->value = hsv.v;
+}
 
+// Recorded into `commands`; the entity exists once flush_commands runs, and
+// its id is written to `result`
+bool spawn_thumb_bundle(Transform *transform, Thumb *thumb, Color *color, TextureId thumb_texture_id, bool visible,
+                        EntityId *result) {
   ComponentRef transform_ref;
-  transform_ref.component_id = find_id(FiascoIds.Transform);
-  transform_ref.component_size = sizeof(transform);
-  transform_ref.component_val = &transform;
-
-  Thumb thumb;
-  thumb.angle = random_float_range(0, 6);
-  thumb.speed = random_float_range(100, 1000);
+  transform_ref.component_id = fiasco_ids.Transform;
+  transform_ref.component_size = sizeof(Transform);
+  transform_ref.component_val = transform;
 
   ComponentRef thumb_ref;
-  thumb_ref.component_id = find_id(THUMB_ID);
-  thumb_ref.component_size = sizeof(thumb);
-  thumb_ref.component_val = &thumb;
+  thumb_ref.component_id = thumb_id;
+  thumb_ref.component_size = sizeof(Thumb);
+  thumb_ref.component_val = thumb;
 
   TextureRender texture_render;
   texture_render.asset_id = thumb_texture_id;
-  texture_render.visible = true;
+  texture_render.visible = visible;
 
   ComponentRef texture_render_ref;
-  texture_render_ref.component_id = find_id(FiascoIds.TextureRender);
+  texture_render_ref.component_id = fiasco_ids.TextureRender;
   texture_render_ref.component_size = sizeof(texture_render);
   texture_render_ref.component_val = &texture_render;
 
+  ComponentRef color_ref;
+  color_ref.component_id = fiasco_ids.Color;
+  color_ref.component_size = sizeof(Color);
+  color_ref.component_val = color;
+
+  ComponentRef bundle[4] = {transform_ref, thumb_ref, texture_render_ref, color_ref};
+  return command_spawn(&commands, bundle, 4, result);
+}
+
+// A freshly rolled thumb at `vec`. Hidden thumbs stand still until pooled.
+bool spawn_thumb(Vec2 *vec, TextureId thumb_texture_id, bool visible, EntityId *result) {
+  Transform transform;
+  memset(&transform, 0, sizeof(Transform));
+  Thumb thumb;
   Color color;
-  color.r = random_float();
-  color.g = random_float();
-  color.b = random_float();
-  color.a = 1.0f;
+  roll_thumb(vec, &transform, &thumb, &color);
+  if (!visible) thumb.speed = 0;
 
-  ComponentRef color_ref;
-  color_ref.component_id = find_id(FiascoIds.Color);
-  color_ref.component_size = sizeof(color);
-  color_ref.component_val = &color;
+  return spawn_thumb_bundle(&transform, &thumb, &color, thumb_texture_id, visible, result);
+}
+
+// Every thumb the game will ever show is spawned by thumb_spawner, most of
+// them hidden. Later spawns rewrite a pooled entity in place instead of going
+// through engine.spawn/despawn. Slots are handed out in ring order, so once
+// every slot is live the next spawn retires the oldest thumb.
+typedef struct {
+  EntityId *entities; // filled in when the warm-up spawns flush
+  size_t cap;
+  size_t next;
+  size_t live;
+} ThumbPool;
+
+// Set from THUMB_POOL=<n> in init()
+size_t thumb_pool_cap = THUMB_POOL_CAPACITY;
+ThumbPool thumb_pool;
+// Set by thumb_spawner_once, for thumbs spawned later
+TextureId thumb_texture;
+
+// `pool_query` is Query<Thumb, Transform, Color, TextureRender>
+bool pool_thumb(void *pool_query, Vec2 *vec) {
+  if (thumb_pool.cap == 0) return false;
+
+  EntityId entity = thumb_pool.entities[thumb_pool.next];
+  if (entity == 0) return false; // warm-up spawns not flushed yet
+
+  const void *ids[4];
+  if (engine.query_get_entity(pool_query, entity, ids) != 0) return false;
+
+  roll_thumb(vec, (Transform*)ids[1], (Thumb*)ids[0], (Color*)ids[2]);
+  ((TextureRender*)ids[3])->visible = true;
+
+  thumb_pool.next = (thumb_pool.next + 1) % thumb_pool.cap;
+  if (thumb_pool.live < thumb_pool.cap) thumb_pool.live++;
+  thumb_soa.valid = false;
+  thumb_motion.valid = false;
+  return true;
+}
+
+// SNAPSHOT
+
+char *GAME_STATE_ID = "GameState";
+
+// The resource the engine saves and loads. A world of thumbs is too big to
+// live in it, so game_snapshot captures into `game_capture` and
+// resource_serialize/resource_deserialize stream that.
+typedef struct {
+  uint32_t thumbs; // in the last capture or restore
+} GameState;
+
+#define SNAPSHOT_META SNAPSHOT_TAG('M', 'E', 'T', 'A')
+#define SNAPSHOT_CAMERA SNAPSHOT_TAG('C', 'A', 'M', 'R')
+#define SNAPSHOT_THUMBS SNAPSHOT_TAG('T', 'H', 'M', 'B')
+
+// Saved thumb state, one float array per field in this order. New fields go
+// on the end so older readers skip the arrays they don't know.
+#define THUMB_FIELDS(X) \
+  X(thumb, direction.x) X(thumb, direction.y) X(thumb, speed) \
+  X(thumb, hue) X(thumb, saturation) X(thumb, value) \
+  X(transform, position.x) X(transform, position.y) X(transform, position.z) \
+  X(transform, scale.x) X(transform, scale.y) X(transform, skew.x) X(transform, skew.y) \
+  X(transform, pivot.x) X(transform, pivot.y) X(transform, rotation) \
+  X(color, r) X(color, g) X(color, b) X(color, a)
+
+#define CAMERA_FIELDS(X) \
+  X(transform, position.x) X(transform, position.y) X(transform, position.z) \
+  X(transform, scale.x) X(transform, scale.y) X(transform, rotation) \
+  X(camera, orthographic_size)
+
+#define COUNT_FIELD(owner, field) + 1
+#define THUMB_FIELD_COUNT (0 THUMB_FIELDS(COUNT_FIELD))
+#define CAMERA_FIELD_COUNT (0 CAMERA_FIELDS(COUNT_FIELD))
+
+typedef enum {
+  CaptureNone,
+  CaptureReady,
+  CaptureRestorePending, // deserialized, written back by the next game_snapshot
+} CaptureState;
+
+// Structure-of-arrays copy of the world, so a save is a few large writes
+typedef struct {
+  CaptureState state;
+  size_t len;
+  size_t cap;
+  float *fields[THUMB_FIELD_COUNT]; // all in one block with `visible`
+  uint8_t *visible;
+  bool has_camera;
+  float camera[CAMERA_FIELD_COUNT];
+  float hue_clock;
+  uint32_t pool_next;
+  uint32_t pool_live;
+} GameCapture;
+
+GameCapture game_capture;
+
+bool capture_reserve(GameCapture *capture, size_t len) {
+  if (len <= capture->cap) {
+    capture->len = len;
+    return true;
+  }
+
+  float *block = (float*)realloc(capture->fields[0], len * (THUMB_FIELD_COUNT * sizeof(float) + 1));
+  if (block == NULL) return false;
+
+  for (size_t f = 0; f < THUMB_FIELD_COUNT; f++) {
+    capture->fields[f] = block + f * len;
+  }
+  capture->visible = (uint8_t*)(block + THUMB_FIELD_COUNT * len);
+  capture->cap = len;
+  capture->len = len;
+  return true;
+}
+
+void capture_free(GameCapture *capture) {
+  free(capture->fields[0]);
+  memset(capture, 0, sizeof(GameCapture));
+}
+
+typedef struct {
+  GameCapture *capture;
+  size_t index;
+} CaptureCursor;
+
+#define CAPTURE_THUMB(owner, field) capture->fields[f++][i] = owner->field;
+#define RESTORE_THUMB(owner, field) owner->field = capture->fields[f++][i];
+#define CAPTURE_CAMERA(owner, field) capture->camera[f++] = owner->field;
+#define RESTORE_CAMERA(owner, field) owner->field = capture->camera[f++];
+
+// `query` is Query<Thumb, Transform, Color, TextureRender> for both
+void capture_thumb_at(GameCapture *capture, size_t i, const void **ids) {
+  const Thumb *thumb = (const Thumb*)ids[0];
+  const Transform *transform = (const Transform*)ids[1];
+  const Color *color = (const Color*)ids[2];
+  size_t f = 0;
+  THUMB_FIELDS(CAPTURE_THUMB)
+  capture->visible[i] = ((const TextureRender*)ids[3])->visible;
+}
+
+int capture_thumb(const void **ids, void *user_data) {
+  CaptureCursor *cursor = (CaptureCursor*)user_data;
+  size_t i = cursor->index++;
+  if (i < cursor->capture->len) capture_thumb_at(cursor->capture, i, ids);
+  return 0;
+}
+
+// Thumbs past the end of the capture are hidden like unused pool slots
+int restore_thumb(const void **ids, void *user_data) {
+  CaptureCursor *cursor = (CaptureCursor*)user_data;
+  GameCapture *capture = cursor->capture;
+  size_t i = cursor->index++;
+
+  Thumb *thumb = (Thumb*)ids[0];
+  Transform *transform = (Transform*)ids[1];
+  Color *color = (Color*)ids[2];
+  TextureRender *texture_render = (TextureRender*)ids[3];
+  if (i >= capture->len) {
+    thumb->speed = 0;
+    texture_render->visible = false;
+    return 0;
+  }
 
-  const int count = 4;
-  ComponentRef *bundle = (ComponentRef*)malloc(count * sizeof(ComponentRef));
-  bundle[0] = transform_ref;
-  bundle[1] = thumb_ref;
-  bundle[2] = texture_render_ref;
-  bundle[3] = color_ref;
+  size_t f = 0;
+  THUMB_FIELDS(RESTORE_THUMB)
+  texture_render->visible = capture->visible[i] != 0;
+  return 0;
+}
 
-  EntityId entity_id = engine.spawn(bundle, count);
+// Everything but the thumbs: camera, hue clock and pool ring
+void capture_meta(GameCapture *capture, void *camera_query) {
+  const void *ids[2];
+  capture->has_camera = engine.query_len(camera_query) > 0 && engine.query_get(camera_query, 0, ids) == 0;
+  if (capture->has_camera) {
+    const Camera *camera = (const Camera*)ids[0];
+    const Transform *transform = (const Transform*)ids[1];
+    size_t f = 0;
+    CAMERA_FIELDS(CAPTURE_CAMERA)
+  }
 
-  free(bundle);
-  return entity_id;
+  capture->hue_clock = hue_clock;
+  capture->pool_next = (uint32_t)thumb_pool.next;
+  capture->pool_live = (uint32_t)thumb_pool.live;
 }
 
+int capture_game(GameCapture *capture, void *camera_query, void *thumb_query) {
+  size_t count = engine.query_len(thumb_query);
+  if (count > UINT32_MAX || !capture_reserve(capture, count)) {
+    log_error("Could not allocate a capture of %zu thumbs", count);
+    capture->state = CaptureNone;
+    return 1;
+  }
+
+  CaptureCursor cursor = {capture, 0};
+  engine.query_for_each(thumb_query, capture_thumb, &cursor);
+  if (cursor.index < capture->len) capture->len = cursor.index;
+
+  capture_meta(capture, camera_query);
+  capture->state = CaptureReady;
+  log_info("captured %zu thumbs", capture->len);
+  return 0;
+}
+
+
+// Records a spawn for each captured thumb from `begin` on; the first
+// `results_len` ids land in `results`
+// Returns the index it stopped at, `capture->len` once every spawn is recorded
+size_t spawn_captured(const GameCapture *capture, size_t begin, EntityId *results, size_t results_len) {
+  for (size_t i = begin; i < capture->len; i++) {
+    Thumb thumb_value;
+    Transform transform_value;
+    Color color_value;
+    memset(&transform_value, 0, sizeof(Transform));
+    Thumb *thumb = &thumb_value;
+    Transform *transform = &transform_value;
+    Color *color = &color_value;
+    size_t f = 0;
+    THUMB_FIELDS(RESTORE_THUMB)
+    EntityId *result = i < results_len ? &results[i] : NULL;
+    if (!spawn_thumb_bundle(transform, thumb, color, thumb_texture, capture->visible[i] != 0, result)) {
+      log_error("Could not record the spawn of saved thumb %zu", i);
+      return i;
+    }
+  }
+  return capture->len;
+}
+
+// Existing thumbs are rewritten in query order and any the capture has beyond
+// them are spawned, so a save loads into a world of any size
+int restore_game(GameCapture *capture, void *camera_query, void *thumb_query) {
+  CaptureCursor cursor = {capture, 0};
+  engine.query_for_each(thumb_query, restore_thumb, &cursor);
+
+  if (spawn_captured(capture, cursor.index, NULL, 0) < capture->len) return 1;
+
+  const void *ids[2];
+  if (capture->has_camera && engine.query_len(camera_query) > 0 && engine.query_get(camera_query, 0, ids) == 0) {
+    Camera *camera = (Camera*)ids[0];
+    Transform *transform = (Transform*)ids[1];
+    size_t f = 0;
+    CAMERA_FIELDS(RESTORE_CAMERA)
+  }
+
+  hue_clock = capture->hue_clock;
+  if (thumb_pool.cap > 0) {
+    thumb_pool.next = capture->pool_next % thumb_pool.cap;
+    thumb_pool.live = capture->pool_live < thumb_pool.cap ? capture->pool_live : thumb_pool.cap;
+  }
+  thumb_soa.valid = false;
+  thumb_motion.valid = false;
+  capture->state = CaptureReady;
+  log_info("restored %zu thumbs, %zu spawned", capture->len,
+           capture->len > cursor.index ? capture->len - cursor.index : 0);
+  return 0;
+}
+
+bool save_game(const GameCapture *capture, void *writer, write_t write) {
+  SnapshotWriter w;
+  snapshot_write_begin(&w, writer, write);
+
+  snapshot_write_section(&w, SNAPSHOT_META, 1, 4 * sizeof(uint32_t));
+  snapshot_write_f32(&w, capture->hue_clock);
+  snapshot_write_u32(&w, capture->pool_next);
+  snapshot_write_u32(&w, capture->pool_live);
+  snapshot_write_u32(&w, THUMB_VERSION);
+  snapshot_write_section_end(&w);
+
+  if (capture->has_camera) {
+    snapshot_write_section(&w, SNAPSHOT_CAMERA, 1, CAMERA_FIELD_COUNT * sizeof(float));
+    snapshot_write_f32s(&w, capture->camera, CAMERA_FIELD_COUNT);
+    snapshot_write_section_end(&w);
+  }
+
+  uint64_t len = capture->len;
+  snapshot_write_section(&w, SNAPSHOT_THUMBS, 1, sizeof(uint32_t) + len * (THUMB_FIELD_COUNT * sizeof(float) + 1));
+  snapshot_write_u32(&w, (uint32_t)len);
+  for (size_t f = 0; f < THUMB_FIELD_COUNT; f++) {
+    snapshot_write_f32s(&w, capture->fields[f], len);
+  }
+  snapshot_write_bytes(&w, capture->visible, len);
+  snapshot_write_section_end(&w);
+
+  bool ok = snapshot_write_end(&w);
+  if (ok) {
+    log_info("saved %zu thumbs in %llu bytes", capture->len, (unsigned long long)w.bytes);
+  } else {
+    log_error("Saving %zu thumbs failed after %llu bytes", capture->len, (unsigned long long)w.bytes);
+  }
+  return ok;
+}
+
+// Unknown sections and the unknown tail of newer known ones are skipped
+bool load_game(GameCapture *capture, void *reader, read_t read) {
+  SnapshotReader r;
+  bool has_thumbs = false;
+  uint32_t thumb_version = 0;
+  uint32_t tag;
+  uint16_t version;
+  uint64_t length;
+
+  capture->has_camera = false;
+  snapshot_read_begin(&r, reader, read);
+  while (!r.failed && snapshot_read_section(&r, &tag, &version, &length)) {
+    if (tag == SNAPSHOT_META) {
+      snapshot_read_f32(&r, &capture->hue_clock);
+      snapshot_read_u32(&r, &capture->pool_next);
+      snapshot_read_u32(&r, &capture->pool_live);
+      snapshot_read_u32(&r, &thumb_version);
+    } else if (tag == SNAPSHOT_CAMERA) {
+      capture->has_camera = snapshot_read_f32s(&r, capture->camera, CAMERA_FIELD_COUNT);
+    } else if (tag == SNAPSHOT_THUMBS) {
+      uint32_t count = 0;
+      snapshot_read_u32(&r, &count);
+      // a damaged count must not size the allocation
+      if (!r.failed && length < sizeof(count) + (uint64_t)count * (THUMB_FIELD_COUNT * sizeof(float) + 1)) {
+        log_error("The snapshot claims %u thumbs in a %llu byte section", count, (unsigned long long)length);
+        r.failed = true;
+      }
+      if (!r.failed && !capture_reserve(capture, count)) {
+        log_error("Could not allocate a capture of %u thumbs", count);
+        r.failed = true;
+      }
+      for (size_t f = 0; f < THUMB_FIELD_COUNT && !r.failed; f++) {
+        snapshot_read_f32s(&r, capture->fields[f], count);
+      }
+      if (!r.failed) snapshot_read_bytes(&r, capture->visible, count);
+      has_thumbs = !r.failed;
+    } else {
+      log_debug("skipping snapshot section %08x version %u", tag, version);
+    }
+    snapshot_read_section_end(&r);
+  }
+
+  // the thumb arrays are only meaningful in the layout they were saved with
+  if (!r.failed && has_thumbs && thumb_version != THUMB_VERSION) {
+    log_error("The snapshot has thumb layout %u, this build reads %u", thumb_version, THUMB_VERSION);
+    r.failed = true;
+  }
+
+  bool ok = !r.failed && has_thumbs;
+  if (ok) {
+    log_info("loaded %zu thumbs from %llu bytes", capture->len, (unsigned long long)r.bytes);
+  } else {
+    log_error("Loading the snapshot failed after %llu bytes", (unsigned long long)r.bytes);
+  }
+  snapshot_read_end(&r);
+  return ok;
+}
+
+// WARM START
+
+#define WARM_START_BATCH 4096
+
+// Set from FIASCO_WARM_START=<path> in init()
+const char *warm_start_path = NULL;
+
+size_t write_file(void *file, void *buf, size_t len) {
+  return fwrite(buf, 1, len, (FILE*)file);
+}
+
+// Written beside `path` and renamed over it, so a crash mid-write never
+// leaves a torn cache behind
+bool write_warm_start(const GameCapture *capture, const char *path) {
+  char tmp[1024];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  FILE *file = fopen(tmp, "wb");
+  if (file == NULL) {
+    log_error("Could not open %s", tmp);
+    return false;
+  }
+
+  bool ok = save_game(capture, file, write_file);
+  ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+  if (ok) remove(path); // rename does not replace on Windows
+#endif
+  if (!ok || rename(tmp, path) != 0) {
+    log_error("Could not write the warm start cache %s", path);
+    remove(tmp);
+    return false;
+  }
+  return true;
+}
+
+// Spawns the saved thumbs straight out of the mapped file, without the read
+// stream or a capture buffer in between. Runs from flush_commands, which has
+// the world to itself, and flushes as it goes. False when the cache is
+// missing, stale or damaged and the world should start cold. Otherwise
+// `spawned` is how many thumbs it spawned, which is fewer than were saved if
+// a spawn could not be recorded. The first thumbs fill the pool's slots and
+// spawn_world fills the rest.
+bool warm_start(const char *path, Camera *camera, Transform *transform, size_t *spawned) {
+  *spawned = 0;
+  SnapshotMap map;
+  if (!snapshot_little_endian() || !snapshot_map(&map, path)) {
+    log_info("no usable warm start cache at %s", path);
+    return false;
+  }
+
+  uint16_t version;
+  uint64_t meta_len, thumbs_len, camera_len;
+  const uint8_t *meta = snapshot_map_section(&map, SNAPSHOT_META, &version, &meta_len);
+  const uint8_t *thumbs = snapshot_map_section(&map, SNAPSHOT_THUMBS, &version, &thumbs_len);
+  const uint8_t *saved_camera = snapshot_map_section(&map, SNAPSHOT_CAMERA, &version, &camera_len);
+
+  uint32_t header[4] = {0};
+  if (meta != NULL && meta_len >= sizeof(header)) memcpy(header, meta, sizeof(header));
+  uint32_t count = 0;
+  if (thumbs != NULL && thumbs_len >= sizeof(count)) memcpy(&count, thumbs, sizeof(count));
+
+  if (header[3] != THUMB_VERSION || thumbs == NULL || ((uintptr_t)thumbs & 3) != 0 ||
+      thumbs_len < sizeof(count) + (uint64_t)count * (THUMB_FIELD_COUNT * sizeof(float) + 1)) {
+    log_info("warm start cache %s is stale or damaged, starting cold", path);
+    snapshot_unmap(&map);
+    return false;
+  }
+
+  GameCapture view;
+  memset(&view, 0, sizeof(GameCapture));
+  GameCapture *capture = &view;
+  view.len = count;
+  for (size_t f = 0; f < THUMB_FIELD_COUNT; f++) {
+    view.fields[f] = (float*)(thumbs + sizeof(count)) + f * count;
+  }
+  view.visible = (uint8_t*)(thumbs + sizeof(count) + (size_t)count * THUMB_FIELD_COUNT * sizeof(float));
+
+  // flushed a batch at a time, so the command buffer stays cache sized
+  // instead of faulting in a couple of hundred bytes per thumb
+  for (size_t begin = 0; begin < count && *spawned == begin; begin = view.len) {
+    view.len = count - begin > WARM_START_BATCH ? begin + WARM_START_BATCH : count;
+    *spawned = spawn_captured(&view, begin, thumb_pool.entities, thumb_pool.cap);
+    command_buffer_flush(&commands, engine.spawn, engine.despawn);
+  }
+  thumb_soa.valid = false;
+  thumb_motion.valid = false;
+
+  if (saved_camera != NULL && camera_len >= sizeof(view.camera)) {
+    memcpy(view.camera, saved_camera, sizeof(view.camera));
+    size_t f = 0;
+    CAMERA_FIELDS(RESTORE_CAMERA)
+  }
+  memcpy(&hue_clock, &header[0], sizeof(float));
+  thumb_pool.next = header[1] % thumb_pool.cap;
+  thumb_pool.live = header[2] < thumb_pool.cap ? header[2] : thumb_pool.cap;
+
+  snapshot_unmap(&map);
+  if (*spawned < count) {
+    log_error("warm start spawned only %zu of %u thumbs from %s", *spawned, count, path);
+  } else {
+    log_info("warm start spawned %u thumbs from %s", count, path);
+  }
+  return true;
+}
+
+// AUTOSAVE
+
+#define AUTOSAVE_SLICE 64
+
+// Set from FIASCO_AUTOSAVE=<path>, FIASCO_AUTOSAVE_INTERVAL=<seconds>,
+// FIASCO_AUTOSAVE_BUDGET_US=<us> and FIASCO_AUTOSAVE_COMPACT=<deltas> in init()
+const char *autosave_path = NULL;
+float autosave_interval = 10;
+uint64_t autosave_budget_ns = 50000;
+uint32_t autosave_compact = 16;
+
+// One capture is filled a slice per frame while the other holds the last
+// save, which the worker diffs against; they swap after every save
+GameCapture autosave_captures[2];
+size_t autosave_filling = 0;
+bool autosave_capturing = false;
+size_t autosave_cursor = 0;
+float autosave_timer = 0;
+
+// Everything but the thumb arrays, saved with each autosave in native byte
+// order; an autosave is only read back where it was written
+typedef struct {
+  uint32_t thumb_version;
+  uint32_t len;
+  uint32_t cap; // the blob holds `cap` entries per field
+  uint32_t has_camera;
+  float camera[CAMERA_FIELD_COUNT];
+  float hue_clock;
+  uint32_t pool_next;
+  uint32_t pool_live;
+} AutosaveHeader;
+
+// A capture's arrays, from fields[0] on, as the one blob the worker saves
+size_t capture_blob_len(const GameCapture *capture) {
+  return capture->cap * (THUMB_FIELD_COUNT * sizeof(float) + 1);
+}
+
+// Copies thumbs into the capture being filled until this frame's budget is
+// spent, then hands the finished capture to the worker. The copy spans
+// frames, so every thumb is saved whole but not all from the same frame.
+int autosave_step(void *camera_query, void *thumb_query, float delta) {
+  if (autosave_path == NULL || autosave_busy()) return 0;
+
+  GameCapture *capture = &autosave_captures[autosave_filling];
+  if (!autosave_capturing) {
+    autosave_timer += delta;
+    if (autosave_timer < autosave_interval) return 0;
+    autosave_timer = 0;
+
+    size_t count = engine.query_len(thumb_query);
+    if (count > UINT32_MAX || !capture_reserve(capture, count)) {
+      log_error("Could not allocate an autosave of %zu thumbs", count);
+      return 1;
+    }
+    autosave_cursor = 0;
+    autosave_capturing = true;
+  }
+
+  uint64_t deadline = clock_ns() + autosave_budget_ns;
+  const void *ids[4];
+  while (autosave_cursor < capture->len && clock_ns() < deadline) {
+    size_t end = capture->len - autosave_cursor > AUTOSAVE_SLICE ? autosave_cursor + AUTOSAVE_SLICE : capture->len;
+    for (; autosave_cursor < end; autosave_cursor++) {
+      if (engine.query_get(thumb_query, autosave_cursor, ids) != 0) break;
+      capture_thumb_at(capture, autosave_cursor, ids);
+    }
+    // thumbs only go away if the world shrank under the capture
+    if (autosave_cursor < end) capture->len = autosave_cursor;
+  }
+  if (autosave_cursor < capture->len) return 0;
+
+  capture_meta(capture, camera_query);
+  AutosaveHeader header;
+  memset(&header, 0, sizeof(AutosaveHeader));
+  header.thumb_version = THUMB_VERSION;
+  header.len = (uint32_t)capture->len;
+  header.cap = (uint32_t)capture->cap;
+  header.has_camera = capture->has_camera;
+  memcpy(header.camera, capture->camera, sizeof(header.camera));
+  header.hue_clock = capture->hue_clock;
+  header.pool_next = capture->pool_next;
+  header.pool_live = capture->pool_live;
+
+  const GameCapture *base = &autosave_captures[1 - autosave_filling];
+  autosave_submit(capture->fields[0], capture_blob_len(capture), base->fields[0], capture_blob_len(base), &header,
+                  sizeof(header));
+  autosave_filling = 1 - autosave_filling;
+  autosave_capturing = false;
+  autosave_timer = 0;
+  return 0;
+}
+
+// Loads the latest autosave into `game_capture` for restore_game
+bool load_autosave(const char *path) {
+  autosave_wait();
+
+  uint8_t *blob;
+  size_t len;
+  AutosaveHeader header;
+  if (!autosave_load(path, &blob, &len, &header, sizeof(header))) {
+    log_warn("No autosave to load at %s", path);
+    return false;
+  }
+
+  size_t cap = header.cap;
+  bool ok = header.thumb_version == THUMB_VERSION && header.len <= cap &&
+            len >= cap * (THUMB_FIELD_COUNT * sizeof(float) + 1) && capture_reserve(&game_capture, header.len);
+  if (ok) {
+    for (size_t f = 0; f < THUMB_FIELD_COUNT; f++) {
+      memcpy(game_capture.fields[f], blob + f * cap * sizeof(float), header.len * sizeof(float));
+    }
+    memcpy(game_capture.visible, blob + THUMB_FIELD_COUNT * cap * sizeof(float), header.len);
+    game_capture.has_camera = header.has_camera != 0;
+    memcpy(game_capture.camera, header.camera, sizeof(header.camera));
+    game_capture.hue_clock = header.hue_clock;
+    game_capture.pool_next = header.pool_next;
+    game_capture.pool_live = header.pool_live;
+  } else {
+    log_warn("Autosave %s does not match this build", path);
+  }
+  free(blob);
+  return ok;
+}
+
+// END SNAPSHOT
+
 // SYSTEMS
 
 typedef enum {
-  ThumbMover,
+  ReadInput,
+  ThumbMovement,
+  ThumbColor,
+  ThumbBounce,
+  ThumbCollider,
   ThumbSpawnerOnce,
+  ThumbSpawner,
   Controller,
-  AlignControlsText
+  AlignControlsText,
+  GameSnapshot,
+  FlushCommands,
+  SystemsCount
 } Systems;
 
-int thumb_mover(const void** ptr) {
-  const void *query = ptr[0];
-  const FrameConstants *consts = (FrameConstants*)(ptr[1]);
-  const Aspect *aspect = (Aspect*)(ptr[2]);
-
-  Screen screen = aspect_to_screen(aspect);
-
-  int count = engine.query_len(query);
-  if (count == 0)
+typedef enum {
+  Serial,
+  Parallel,
+  Soa
+} ExecutionMode;
+
+// Set from THUMB_MOVER_MODE=serial|parallel|soa in init(). Soa changes
+// thumb_movement and thumb_color, which then run SIMD kernels over
+// structure-of-arrays copies.
+ExecutionMode thumb_mover_mode = Parallel;
+
+// Runs `fn` on every entity in `query`, on the engine's workers unless the
+// mode is Serial. `fn` must only write the entity it is handed.
+int for_each_thumb(const void *query, para_for_each_t fn, const void *user_data) {
+  if (thumb_mover_mode != Serial) {
+    engine.query_par_for_each(query, fn, user_data);
     return 0;
+  }
 
+  int count = engine.query_len(query);
   for (int i = 0; i < count; i++) {
-    const void *ids[3];
+    const void *ids[MAX_QUERY_COMPONENTS];
     int code = engine.query_get(query, i, (const void **)&ids);
 
     if (code != 0) {
-      printf("thumb query get failed\n");
+      log_error("thumb query get failed");
       return 1;
     }
 
-    Thumb *thumb = (Thumb*)ids[0];
-    Transform *transform = (Transform*)ids[1];
-    Color *color = (Color*)ids[2];
-
-    float speed = consts->delta * thumb->speed;
-    transform->rotation -= consts->delta * 2;
-    transform->position.x += cosf(thumb->angle) * speed;
-    transform->position.y += sinf(thumb->angle) * speed;
-
-    if (transform->position.x > screen.right) {
-      transform->position.x = screen.right;
-      thumb->angle = M_PI - thumb->angle;
-    } else if (transform->position.x < screen.left) {
-      transform->position.x = screen.left;
-      thumb->angle = M_PI - thumb->angle;
-    } else if (transform->position.y > screen.top) {
-      transform->position.y = screen.top;
-      thumb->angle = -thumb->angle;
-    } else if (transform->position.y < screen.bottom) {
-      transform->position.y = screen.bottom;
-      thumb->angle = -thumb->angle;
+    fn(ids, user_data);
+  }
+
+  return 0;
+}
+
+typedef struct {
+  float delta;
+  Screen screen;
+} ThumbFrame;
+
+// Query<Thumb, Transform>: writes Transform only. Thumbs stop at the screen
+// edge and thumb_bounce turns them around.
+int move_thumb(const void **ids, const void *user_data) {
+  const Thumb *thumb = (Thumb*)ids[0];
+  Transform *transform = (Transform*)ids[1];
+  const ThumbFrame *frame = (const ThumbFrame*)user_data;
+  const Screen screen = frame->screen;
+
+  float speed = frame->delta * thumb->speed;
+  float x = transform->position.x + thumb->direction.x * speed;
+  float y = transform->position.y + thumb->direction.y * speed;
+
+  transform->rotation -= frame->delta * 2;
+  transform->position.x = x > screen.right ? screen.right : x < screen.left ? screen.left : x;
+  transform->position.y = y > screen.top ? screen.top : y < screen.bottom ? screen.bottom : y;
+  return 0;
+}
+
+// Query<Thumb, Transform>: writes Thumb only. A thumb on an edge that is
+// still heading out turns back.
+int bounce_thumb(const void **ids, const void *user_data) {
+  Thumb *thumb = (Thumb*)ids[0];
+  const Transform *transform = (Transform*)ids[1];
+  const Screen *screen = (const Screen*)user_data;
+  float x = transform->position.x;
+  float y = transform->position.y;
+
+  if ((x >= screen->right && thumb->direction.x > 0) || (x <= screen->left && thumb->direction.x < 0)) {
+    thumb->direction.x = -thumb->direction.x;
+  }
+  if ((y >= screen->top && thumb->direction.y > 0) || (y <= screen->bottom && thumb->direction.y < 0)) {
+    thumb->direction.y = -thumb->direction.y;
+  }
+  return 0;
+}
+
+// Query<Thumb, Color>: writes Color only. Hue is Thumb.hue plus `offset`,
+// wrapped at HUE_WRAP.
+int color_thumb(const void **ids, const void *user_data) {
+  const Thumb *thumb = (Thumb*)ids[0];
+  Color *color = (Color*)ids[1];
+  float hue = thumb->hue + *(const float*)user_data;
+  if (hue >= HUE_WRAP) hue -= HUE_WRAP;
+
+  // v - v*s + v*s*lut, i.e. the saturated hue scaled back to this thumb's s/v
+  const Color lut = hue_lut[(int)hue];
+  float base = thumb->value - thumb->value * thumb->saturation;
+  float scale = thumb->value * thumb->saturation;
+  color->r = base + scale * lut.r;
+  color->g = base + scale * lut.g;
+  color->b = base + scale * lut.b;
+  return 0;
+}
+
+typedef struct {
+  ThumbSoa *soa;
+  size_t index;
+} ThumbSoaCursor;
+
+int gather_thumb(const void **ids, void *user_data) {
+  ThumbSoaCursor *cursor = (ThumbSoaCursor*)user_data;
+  ThumbSoa *soa = cursor->soa;
+  size_t i = cursor->index++;
+
+  const Thumb *thumb = (Thumb*)ids[0];
+  soa->h[i] = thumb->hue;
+  soa->s[i] = thumb->saturation;
+  soa->v[i] = thumb->value;
+  return 0;
+}
+
+int scatter_thumb(const void **ids, void *user_data) {
+  ThumbSoaCursor *cursor = (ThumbSoaCursor*)user_data;
+  const ThumbSoa *soa = cursor->soa;
+  size_t i = cursor->index++;
+
+  Color *color = (Color*)ids[1];
+  color->r = soa->r[i];
+  color->g = soa->g[i];
+  color->b = soa->b[i];
+  return 0;
+}
+
+// Hue phase, saturation and value only change when a thumb is spawned or
+// pooled, so the shadow is gathered then and only colors are scattered back.
+int color_thumbs_soa(const void *query, float offset) {
+  size_t count = engine.query_len(query);
+  ThumbSoaCursor cursor = {&thumb_soa, 0};
+
+  if (!thumb_soa.valid || thumb_soa.len != count) {
+    if (!thumb_soa_reserve(&thumb_soa, count)) {
+      log_error("thumb soa allocation failed for %zu thumbs", count);
+      return 1;
     }
+    engine.query_for_each(query, gather_thumb, &cursor);
+    thumb_soa.valid = cursor.index == count;
+  }
 
-    HSVA hsv = rgb_to_hsv(*color);
-    if (hsv.h >= 355) {
-      hsv.h = 0;
-    } else {
-      hsv.h += consts->delta * 100;
+  thumb_soa_color(&thumb_soa, offset);
+
+  cursor.index = 0;
+  engine.query_for_each(query, scatter_thumb, &cursor);
+  return 0;
+}
+
+typedef struct {
+  ThumbMotion *motion;
+  size_t index;
+} ThumbMotionCursor;
+
+int gather_motion(const void **ids, void *user_data) {
+  ThumbMotionCursor *cursor = (ThumbMotionCursor*)user_data;
+  ThumbMotion *motion = cursor->motion;
+  size_t i = cursor->index++;
+
+  const Thumb *thumb = (Thumb*)ids[0];
+  const Transform *transform = (Transform*)ids[1];
+  motion->x[i] = transform->position.x;
+  motion->y[i] = transform->position.y;
+  motion->rotation[i] = transform->rotation;
+  motion->dir_x[i] = thumb->direction.x;
+  motion->dir_y[i] = thumb->direction.y;
+  motion->speed[i] = thumb->speed;
+  return 0;
+}
+
+int scatter_motion(const void **ids, void *user_data) {
+  ThumbMotionCursor *cursor = (ThumbMotionCursor*)user_data;
+  const ThumbMotion *motion = cursor->motion;
+  size_t i = cursor->index++;
+
+  Transform *transform = (Transform*)ids[1];
+  transform->position.x = motion->x[i];
+  transform->position.y = motion->y[i];
+  transform->rotation = motion->rotation[i];
+  return 0;
+}
+
+// The copy stays valid between frames: the kernel repeats thumb_bounce's
+// turn on its own headings, and everything else that writes these fields
+// clears `valid`. Only the scatter of Transform is paid every frame.
+int move_thumbs_soa(const void *query, const ThumbFrame *frame) {
+  size_t count = engine.query_len(query);
+  ThumbMotionCursor cursor = {&thumb_motion, 0};
+
+  if (!thumb_motion.valid || thumb_motion.len != count) {
+    if (!thumb_motion_reserve(&thumb_motion, count)) {
+      log_error("thumb motion allocation failed for %zu thumbs", count);
+      return 1;
     }
+    engine.query_for_each(query, gather_motion, &cursor);
+    thumb_motion.valid = cursor.index == count;
+  }
+
+  thumb_motion_step(&thumb_motion, frame->delta, frame->screen);
 
-    Color c = hsv_to_rgb(hsv);
-    color->r = c.r;
-    color->g = c.g;
-    color->b = c.b;
+  cursor.index = 0;
+  engine.query_for_each(query, scatter_motion, &cursor);
+  return 0;
+}
+
+// Decoded by read_input; the systems after it test bits here instead of
+// parsing the engine's input bytes again
+InputFrame frame_input;
+
+// First in the table, so a recording sees the frame's input before anything
+// acts on it and a playback replaces it for every system that follows
+int read_input(void **ptr) {
+  uint8_t *input = (uint8_t*)ptr[0];
+  FrameConstants *frame = (FrameConstants*)ptr[1];
+  replay_frame(input, (float*)&frame->delta);
+  input_decode(&frame_input, input);
+  return 0;
+}
+
+int thumb_movement(const void** ptr) {
+  const void *query = ptr[0];
+  const FrameConstants *consts = (FrameConstants*)(ptr[1]);
+  const Aspect *aspect = (Aspect*)(ptr[2]);
+
+  ThumbFrame frame;
+  frame.delta = consts->delta;
+  frame.screen = aspect_to_screen(aspect);
+  if (thumb_mover_mode == Soa) {
+    return move_thumbs_soa(query, &frame);
   }
+  return for_each_thumb(query, move_thumb, &frame);
+}
 
+int thumb_bounce(const void** ptr) {
+  const void *query = ptr[0];
+  const Aspect *aspect = (Aspect*)(ptr[1]);
+
+  Screen screen = aspect_to_screen(aspect);
+  return for_each_thumb(query, bounce_thumb, &screen);
+}
+
+int thumb_color(const void** ptr) {
+  const void *query = ptr[0];
+  const FrameConstants *consts = (FrameConstants*)(ptr[1]);
+
+  hue_clock = fmodf(hue_clock + consts->delta, (float)HUE_WRAP / HUE_SPEED);
+  float offset = hue_offset();
+
+  if (thumb_mover_mode == Soa) {
+    return color_thumbs_soa(query, offset);
+  }
+  return for_each_thumb(query, color_thumb, &offset);
+}
+
+// Set from THUMB_COLLISIONS=0|1 in init()
+bool thumb_collisions = true;
+SpatialGrid thumb_grid;
+// Set by the collide pass when it turned any thumb
+volatile uint64_t thumbs_turned;
+
+// Pooled thumbs that are hidden take no part in collisions
+int count_thumb(const void **ids, const void *user_data) {
+  if (!((const TextureRender*)ids[2])->visible) return 0;
+  const Transform *transform = (Transform*)ids[1];
+  spatial_grid_count((SpatialGrid*)user_data, transform->position.x, transform->position.y);
+  return 0;
+}
+
+GridEntry grid_entry(Thumb *thumb, const Transform *transform) {
+  GridEntry entry;
+  entry.x = transform->position.x;
+  entry.y = transform->position.y;
+  entry.radius = 0.5f * fmaxf(transform->scale.x, transform->scale.y);
+  entry.direction = &thumb->direction;
+  return entry;
+}
+
+int insert_thumb(const void **ids, const void *user_data) {
+  if (!((const TextureRender*)ids[2])->visible) return 0;
+  spatial_grid_insert((SpatialGrid*)user_data, grid_entry((Thumb*)ids[0], (const Transform*)ids[1]));
   return 0;
 }
 
+// Turns the thumb's own heading; the grid holds everyone's positions, so no
+// other thumb is read through the engine
+int collide_thumb(const void **ids, const void *user_data) {
+  if (!((const TextureRender*)ids[2])->visible) return 0;
+  if (spatial_grid_bounce((const SpatialGrid*)user_data, grid_entry((Thumb*)ids[0], (const Transform*)ids[1])) > 0) {
+    atomic_store_u64(&thumbs_turned, 1);
+  }
+  return 0;
+}
+
+// Rebuilds the grid from this frame's positions and bounces overlapping
+// thumbs off each other. Every pass but the prefix sum and the bucket sort
+// runs on the engine's worker threads.
+int thumb_collider(const void** ptr) {
+  const void *query = ptr[0];
+
+  if (!thumb_collisions) return 0;
+
+  int count = engine.query_len(query);
+  if (count == 0) return 0;
+
+  if (!spatial_grid_begin(&thumb_grid, count)) {
+    log_error("spatial grid allocation failed for %d thumbs", count);
+    return 1;
+  }
+
+  engine.query_par_for_each(query, count_thumb, &thumb_grid);
+  spatial_grid_prefix(&thumb_grid);
+  engine.query_par_for_each(query, insert_thumb, &thumb_grid);
+  spatial_grid_sort(&thumb_grid);
+  atomic_store_u64(&thumbs_turned, 0);
+  engine.query_par_for_each(query, collide_thumb, &thumb_grid);
+  // the soa movement copy holds headings too
+  if (atomic_load_u64(&thumbs_turned) != 0) thumb_motion.valid = false;
+  return 0;
+}
+
+// Absolute path of thumb_path, the key of the thumb texture in texture_cache
+char *thumb_texture_path;
+// Set once thumb_spawner has seen the thumb texture settle
+bool thumbs_spawned;
+// Set by thumb_spawner for flush_commands to spawn the world
+bool world_pending;
+Screen world_screen;
+
+// Issues every texture load up front; thumb_spawner makes the world once the
+// thumb texture is ready, so no thumb shows before it can be drawn
 int thumb_spawner_once(void** ptr) {
+  void *gpu_interface = ptr[0];
+  void *event_writer_new_texture = ptr[1];
+
+  thumb_texture_path = asset_path(&persistent_arena, thumb_path);
+  if (thumb_texture_path == NULL) {
+    log_error("Could not build the path to %s", thumb_path);
+    return 1;
+  }
+
+  void *texture_asset_manager = engine.gpu_interface_get_texture_asset_manager_mut(gpu_interface);
+  uint64_t span = trace_begin();
+  bool loading = textures_load(&texture_cache, texture_asset_manager, event_writer_new_texture, thumb_texture_path,
+                               &thumb_texture);
+  trace_end("load_texture", "texture", span);
+  if (!loading) return 1;
+
+  // a missing manifest is fine, the thumb is all the game needs
+  FILE *manifest = fopen(texture_manifest, "r");
+  if (manifest != NULL) {
+    fclose(manifest);
+    textures_load_manifest(&texture_cache, texture_asset_manager, event_writer_new_texture, texture_manifest);
+  }
+  return 0;
+}
+
+// Polls the texture loads every frame until they settle. In the frame the
+// thumb texture becomes ready it leaves the world to flush_commands, the one
+// system that runs alone: a warm start writes the hue clock and the pool ring
+// and spawns through the engine directly.
+int thumb_spawner(void** ptr) {
   const Aspect *aspect = (Aspect*)ptr[0];
-  Screen screen = aspect_to_screen(aspect);
   void *gpu_interface = ptr[1];
-  void *event_writer_new_texture = ptr[2];
 
-  char *current_path = current_dir();
-  strcat(current_path, thumb_path);
+  if (texture_cache.pending_len > 0) {
+    void *texture_asset_manager = engine.gpu_interface_get_texture_asset_manager_mut(gpu_interface);
+    if (textures_poll(&texture_cache, texture_asset_manager) == 0) {
+      size_t files = texture_cache.len - texture_cache.sprites - texture_cache.duplicates;
+      log_info("%zu textures loaded, %zu failed", files - texture_cache.failed, texture_cache.failed);
+      if (texture_cache.sprites > 0) log_info("%zu atlas sprites on their sheets", texture_cache.sprites);
+      if (texture_cache.index_path != NULL) {
+        log_info("%zu files hashed, %zu from the index, %zu duplicates shared", texture_cache.hashed,
+                 texture_cache.index_hits, texture_cache.duplicates);
+        textures_save_index(&texture_cache);
+      }
+    }
+  }
+  if (thumbs_spawned || thumb_texture_path == NULL) return 0;
 
-  PendingTexture pending_texture; 
-  void *texture_asset_manager = engine.gpu_interface_get_texture_asset_manager_mut(gpu_interface);
-  LoadTextureStatus status = engine.texture_asset_manager_load_texture(texture_asset_manager, event_writer_new_texture, current_path, true, &pending_texture);
-  free(current_path);
+  const TextureEntry *texture = textures_find(&texture_cache, thumb_texture_path);
+  if (texture == NULL || texture->state == TexturePending) return 0;
+  if (texture->state == TextureFailed) {
+    log_error("Thumbs fall back to the missing texture");
+    thumb_texture = engine.texture_asset_manager_missing_texture_id();
+  }
+  thumbs_spawned = true;
+  world_screen = aspect_to_screen(aspect);
+  world_pending = true;
+  return 0;
+}
 
-  if (status != LoadPendingTextureSuccess) {
-    printf("There was an error loading the texture. Status %u\n", status);
+// Makes the pool, then fills it from the warm start cache or with fresh
+// thumbs, the first INITIAL_THUMBS of them visible
+int spawn_world(Screen screen) {
+  size_t cap = thumb_pool_cap > INITIAL_THUMBS ? thumb_pool_cap : INITIAL_THUMBS;
+  thumb_pool.entities = (EntityId*)arena_alloc(&persistent_arena, cap * sizeof(EntityId), _Alignof(EntityId));
+  if (thumb_pool.entities == NULL) {
+    log_error("Could not allocate a pool of %zu thumbs", cap);
     return 1;
   }
+  memset(thumb_pool.entities, 0, cap * sizeof(EntityId));
+  thumb_pool.cap = cap;
+  thumb_pool.next = INITIAL_THUMBS % cap;
+  thumb_pool.live = INITIAL_THUMBS;
+
+  Camera camera;
+  Transform camera_transform;
+  init_camera(&camera, &camera_transform);
+  size_t spawned = 0;
+  bool warm = warm_start_path != NULL && warm_start(warm_start_path, &camera, &camera_transform, &spawned);
 
-  for (int i = 0; i < INITIAL_THUMBS; i++) {
+  // pool slots a warm start left empty get hidden thumbs
+  for (size_t i = spawned; i < cap; i++) {
     float x = random_float_range(screen.left, screen.right);
     float y = random_float_range(screen.bottom, screen.top);
     Vec2 vec = {x, y};
-    spawn_thumb(&vec, pending_texture.id);
+    spawn_thumb(&vec, thumb_texture, !warm && i < INITIAL_THUMBS, &thumb_pool.entities[i]);
   }
 
-  spawn_camera();
+  spawn_camera(&camera, &camera_transform);
   spawn_text();
 
   return 0;
 }
 
 int controller(void **ptr) {
-  void *input = ptr[0];
+  const InputFrame *input = &frame_input;
   void *camera_query = ptr[1];
   const Aspect *aspect = (Aspect*)ptr[2];
   const FrameConstants *frame = (FrameConstants*)ptr[3];
-  void *texture_render_query = ptr[4];
+  void *pool_query = ptr[4];
+
+  profiler_frame(frame->delta);
+  // every control below needs a key or button
+  if (input->idle) return 0;
 
   uint32_t camera_count = engine.query_len(camera_query);
   if (camera_count > 0) {
@@ -283,7 +1233,7 @@ int controller(void **ptr) {
     uint32_t code = engine.query_get(camera_query, 0, (const void **)&ids);
 
     if (code != 0) {
-      printf("cam query get failed\n");
+      log_error("cam query get failed");
       return 1;
     }
 
@@ -291,56 +1241,64 @@ int controller(void **ptr) {
     Transform *transform = (Transform*)ids[1];
 
     // Move camera position with WASD
-    if(key(KeyA, input).isHeld) {
+    if (input_bit(input->held, KeyA)) {
       transform->position.x -= frame->delta * CAMERA_MOVE_SCALE;
     }
-    if(key(KeyW, input).isHeld) {
+    if (input_bit(input->held, KeyW)) {
       transform->position.y += frame->delta * CAMERA_MOVE_SCALE;
     }
-    if(key(KeyD, input).isHeld) {
+    if (input_bit(input->held, KeyD)) {
       transform->position.x += frame->delta * CAMERA_MOVE_SCALE;
     }
-    if(key(KeyS, input).isHeld) {
+    if (input_bit(input->held, KeyS)) {
       transform->position.y -= frame->delta * CAMERA_MOVE_SCALE;
     }
 
     // Zoom out with -
-    if (key(Minus, input).isHeld && camera->orthographic_size > 0) {
+    if (input_bit(input->held, Minus) && camera->orthographic_size > 0) {
       camera->orthographic_size -= frame->delta;
     }
     // Zoom in with +
-    if (key(Equal, input).isHeld) {
+    if (input_bit(input->held, Equal)) {
       camera->orthographic_size += frame->delta;
     }
 
     // Rotate camera left with Q
-    if (key(KeyQ, input).isHeld) {
+    if (input_bit(input->held, KeyQ)) {
       transform->rotation += frame->delta;
     }
     // Rotate camera right with E
-    if (key(KeyE, input).isHeld) {
+    if (input_bit(input->held, KeyE)) {
       transform->rotation -= frame->delta;
     }
   }
 
-  MouseState mouse_state = mouse(input);
+  MouseState mouse_state = input->mouse;
   if (mouse_state.left.isHeld) {
     Vec2 vec = mouse_to_screen(mouse_state, aspect);
+    pool_thumb(pool_query, &vec);
+  }
 
-    int texture_render_count = engine.query_len(texture_render_query);
-    if (texture_render_count > 0) {
-      const void *ids[1];
-      const uint32_t ok = engine.query_get(texture_render_query, 0, ids);
-
-      if (ok != 0) {
-        printf("texture_render_query get 0 failed\n");
-        return 1;
-      }
+  // T saves the trace so far when FIASCO_TRACE is set
+  if (input_bit(input->just_pressed, KeyT)) {
+    trace_write(trace_path());
+  }
 
-      TextureRender *texture_render = (TextureRender*)ids[0];
-      spawn_thumb(&vec, texture_render->asset_id);
+  // Space sprays a burst of thumbs across the screen, for load testing
+  if (input_bit(input->held, Space)) {
+    Screen screen = aspect_to_screen(aspect);
+    float *xs = (float*)arena_alloc(&frame_arena, 2 * THUMB_BURST * sizeof(float), _Alignof(float));
+    if (xs == NULL) {
+      log_error("Could not allocate the burst positions");
+      return 1;
+    }
+    float *ys = xs + THUMB_BURST;
+    random_floats(xs, THUMB_BURST, screen.left, screen.right);
+    random_floats(ys, THUMB_BURST, screen.bottom, screen.top);
+    for (int i = 0; i < THUMB_BURST; i++) {
+      Vec2 vec = {xs[i], ys[i]};
+      pool_thumb(pool_query, &vec);
     }
-
   }
 
   return 0;
@@ -362,7 +1320,7 @@ int align_controls_text(void** ptr) {
     int code = engine.query_get(query, i, (const void **)&ids);
 
     if (code != 0) {
-      printf("text controls query get failed\n");
+      log_error("text controls query get failed");
       return 1;
     }
 
@@ -375,15 +1333,140 @@ int align_controls_text(void** ptr) {
   return 0;
 }
 
+// F5 captures the world for resource_serialize; autosaves are captured here
+// a slice at a time. A save resource_deserialize
+// loaded is written back here on the next frame, since only systems get
+// queries.
+int game_snapshot(void **ptr) {
+  const InputFrame *input = &frame_input;
+  void *camera_query = ptr[1];
+  void *thumb_query = ptr[2];
+  const FrameConstants *frame = (FrameConstants*)ptr[3];
+
+  if (game_capture.state == CaptureRestorePending) {
+    return restore_game(&game_capture, camera_query, thumb_query);
+  }
+  // F9 goes back to the latest autosave
+  if (input_bit(input->just_pressed, F9) && autosave_path != NULL && load_autosave(autosave_path)) {
+    return restore_game(&game_capture, camera_query, thumb_query);
+  }
+  if (input_bit(input->just_pressed, F5)) {
+    int code = capture_game(&game_capture, camera_query, thumb_query);
+    // the next launch with the same FIASCO_WARM_START starts from here
+    if (code == 0 && warm_start_path != NULL) write_warm_start(&game_capture, warm_start_path);
+    return code;
+  }
+  return autosave_step(camera_query, thumb_query, frame->delta);
+}
+
+// The single point where recorded spawns/despawns reach the engine
+int flush_commands(const void** ptr) {
+  int code = 0;
+  if (world_pending) {
+    world_pending = false;
+    code = spawn_world(world_screen);
+  }
+
+  uint64_t span = trace_begin();
+  size_t flushed = command_buffer_flush(&commands, engine.spawn, engine.despawn);
+  trace_end("command_buffer_flush", "flush", span);
+
+  if (flushed > 0) {
+    thumb_soa.valid = false;
+    thumb_motion.valid = false;
+  }
+  arena_reset(&frame_arena);
+  // last system of the frame, so it closes the frame's engine call counts
+  ffi_frame();
+  return code;
+}
+
 // END SYSTEMS
 
 char* name() {
   return "Jason C Game";
 }
 int init() {
+  const char *mode = getenv("THUMB_MOVER_MODE");
+  if (mode != NULL && strcmp(mode, "serial") == 0) {
+    thumb_mover_mode = Serial;
+  } else if (mode != NULL && strcmp(mode, "parallel") == 0) {
+    thumb_mover_mode = Parallel;
+  } else if (mode != NULL && strcmp(mode, "soa") == 0) {
+    thumb_mover_mode = Soa;
+  }
+  const char *pool = getenv("THUMB_POOL");
+  if (pool != NULL) {
+    thumb_pool_cap = strtoull(pool, NULL, 10);
+  }
+  const char *collisions = getenv("THUMB_COLLISIONS");
+  if (collisions != NULL) {
+    thumb_collisions = strcmp(collisions, "0") != 0;
+  }
+  warm_start_path = getenv("FIASCO_WARM_START");
+  const char *manifest = getenv("FIASCO_TEXTURES");
+  if (manifest != NULL) texture_manifest = manifest;
+  const char *texture_index = getenv("FIASCO_TEXTURE_INDEX");
+  if (texture_index != NULL) textures_open_index(&texture_cache, texture_index);
+  const char *interval = getenv("FIASCO_AUTOSAVE_INTERVAL");
+  if (interval != NULL) autosave_interval = strtof(interval, NULL);
+  const char *budget = getenv("FIASCO_AUTOSAVE_BUDGET_US");
+  if (budget != NULL) autosave_budget_ns = strtoull(budget, NULL, 10) * 1000;
+  const char *compact = getenv("FIASCO_AUTOSAVE_COMPACT");
+  if (compact != NULL) autosave_compact = (uint32_t)strtoul(compact, NULL, 10);
+  autosave_path = getenv("FIASCO_AUTOSAVE");
+  if (autosave_path != NULL && !autosave_start(autosave_path, autosave_compact)) {
+    log_error("Could not start autosaving to %s", autosave_path);
+    autosave_path = NULL;
+  }
+  // FIASCO_SEED=<n> makes every run spawn the same thumbs
+  const char *seed_env = getenv("FIASCO_SEED");
+  uint64_t seed = seed_env != NULL ? strtoull(seed_env, NULL, 0) : (uint64_t)time(NULL);
+  // a replay brings its own seed, so it plays out as recorded
+  const char *replay_path = getenv("FIASCO_REPLAY");
+  const char *record_path = getenv("FIASCO_RECORD");
+  if (replay_path != NULL) {
+    if (!replay_play(replay_path, &seed)) log_error("Could not replay input from %s", replay_path);
+  } else if (record_path != NULL && !replay_record(record_path, seed)) {
+    log_error("Could not record input to %s", record_path);
+  }
+  random_seed(seed);
+  log_debug("thumb mode %d, pool %zu, collisions %d, simd level %d", thumb_mover_mode, thumb_pool_cap,
+            thumb_collisions, simd_level());
+  init_hue_lut();
   return 0;
 }
 int deinit() {
+  profiler_report();
+  ffi_report();
+  trace_write(trace_path());
+  trace_free();
+  thumb_soa_free(&thumb_soa);
+  thumb_motion_free(&thumb_motion);
+  capture_free(&game_capture);
+  // the worker may still be reading a capture
+  autosave_stop();
+  capture_free(&autosave_captures[0]);
+  capture_free(&autosave_captures[1]);
+  autosave_capturing = false;
+  replay_stop();
+  spatial_grid_free(&thumb_grid);
+  textures_save_index(&texture_cache);
+  textures_free(&texture_cache);
+  thumb_texture_path = NULL;
+  thumbs_spawned = false;
+  memset(&thumb_pool, 0, sizeof(ThumbPool));
+  ArenaStats frame = arena_stats(&frame_arena);
+  ArenaStats persistent = arena_stats(&persistent_arena);
+  log_info("frame arena high water %zu bytes (%zu reserved), persistent arena %zu bytes (%zu reserved)",
+         frame.high_water, frame.reserved, persistent.high_water, persistent.reserved);
+
+  registry_clear(&component_registry);
+  command_buffer_free(&commands);
+  arena_free(&frame_arena);
+  arena_free(&persistent_arena);
+  // the host may unload us next, so the drain thread has to be gone
+  log_stop();
   return 0;
 }
 int component_deserialize_json() {
@@ -391,250 +1474,207 @@ int component_deserialize_json() {
 }
 
 int void_target_version() {
-  printf("void_target_version called\n");
+  log_trace("void_target_version called");
   return make_api_version(engine_version[0], engine_version[1], engine_version[2]);
 }
 
-int current_index = 0;
 void set_component_id(char *string_id, ComponentId id) {
-  printf("%d set_component_id called %s - %d\n", current_index, string_id, id);
-
-  component_id_strs[current_index] = (char**)malloc(sizeof(char*));
+  log_trace("set_component_id called %s - %d", string_id, id);
+  uint64_t span = trace_begin();
 
-  if (component_id_strs[current_index] == NULL) {
-      printf("Memory allocation for pointer failed for index %d!\n", current_index);
-      return;
+  if (!registry_set(&component_registry, string_id, id)) {
+    log_error("Component registry allocation failed for %s!", string_id);
+    return;
   }
 
-  *component_id_strs[current_index] = (char*)malloc(strlen(string_id) + 1);
-
-  if (*component_id_strs[current_index] == NULL) {
-      printf("Memory allocation for string failed for index %d!\n", current_index);
-      free(component_id_strs[current_index]);
-      return;
-  }
-
-  strcpy(*component_id_strs[current_index], string_id);
-  component_ids[current_index] = id;
-  current_index++;
+  // cheap enough to redo per registration, and spawns never hash a string
+  resolve_fiasco_ids(&component_registry, &fiasco_ids);
+  thumb_id = registry_find(&component_registry, THUMB_ID);
+  trace_end("set_component_id", "registration", span);
 }
 
 size_t component_size(char *component_id) {
-  printf("component_size called %s\n", component_id);
+  log_trace("component_size called %s", component_id);
 
   if (strcmp(component_id, THUMB_ID) == 0) return sizeof(Thumb);
+  if (strcmp(component_id, GAME_STATE_ID) == 0) return sizeof(GameState);
 
   return 0;
 }
 
 char* component_string_id(size_t component_index) {
-  printf("component_string_id called %zu\n", component_index);
+  log_trace("component_string_id called %zu", component_index);
 
   if (component_index == 0) return THUMB_ID;
+  if (component_index == 1) return GAME_STATE_ID;
 
   return NULL;
 }
 
 size_t component_align(char *string_id) {
-  printf("component_align called %s\n", string_id);
+  log_trace("component_align called %s", string_id);
 
   if (strcmp(string_id, THUMB_ID) == 0) {
     return _Alignof(Thumb);
   }
+  if (strcmp(string_id, GAME_STATE_ID) == 0) {
+    return _Alignof(GameState);
+  }
 
   return 0;
 }
 
 ComponentType component_type(char *string_id) {
-  printf("component_type called %s\n", string_id);
-  return Component;
+  log_trace("component_type called %s", string_id);
+  return strcmp(string_id, GAME_STATE_ID) == 0 ? Resource : Component;
 }
 
-size_t systems_len() {
-  printf("systems_len called\n");
-  return 4;
+// SYSTEM TABLE
+
+#define REF(id) {&(id), DataAccessRef}
+#define MUT(id) {&(id), DataAccessMut}
+
+// Indexed by Systems; every system export below is a lookup into it
+const SystemDesc system_table[SystemsCount] = {
+  // mutable only so a playback can overwrite them
+  [ReadInput] = {"read_input", (system_func)read_input, false, 2, {
+    {DataAccessMut, &FiascoIds.Inputs},
+    {DataAccessMut, &FiascoIds.FrameConstants},
+  }},
+  [ThumbMovement] = {"thumb_movement", (system_func)thumb_movement, false, 3, {
+    {Query, NULL, 2, {REF(THUMB_ID), MUT(FiascoIds.Transform)}},
+    {DataAccessRef, &FiascoIds.FrameConstants},
+    {DataAccessRef, &FiascoIds.Aspect},
+  }},
+  [ThumbColor] = {"thumb_color", (system_func)thumb_color, false, 2, {
+    {Query, NULL, 2, {REF(THUMB_ID), MUT(FiascoIds.Color)}},
+    {DataAccessRef, &FiascoIds.FrameConstants},
+  }},
+  [ThumbBounce] = {"thumb_bounce", (system_func)thumb_bounce, false, 2, {
+    {Query, NULL, 2, {MUT(THUMB_ID), REF(FiascoIds.Transform)}},
+    {DataAccessRef, &FiascoIds.Aspect},
+  }},
+  [ThumbCollider] = {"thumb_collider", (system_func)thumb_collider, false, 1, {
+    {Query, NULL, 3, {MUT(THUMB_ID), REF(FiascoIds.Transform), REF(FiascoIds.TextureRender)}},
+  }},
+  // loading a texture goes through the texture asset manager's _mut accessor
+  [ThumbSpawnerOnce] = {"thumb_spawner_once", (system_func)thumb_spawner_once, true, 2, {
+    {DataAccessMut, &FiascoIds.GpuInterface},
+    {EventWriter, &FiascoEvents.NewTexture},
+  }},
+  [ThumbSpawner] = {"thumb_spawner", (system_func)thumb_spawner, false, 2, {
+    {DataAccessRef, &FiascoIds.Aspect},
+    {DataAccessMut, &FiascoIds.GpuInterface},
+  }},
+  // Inputs is read through frame_input; declaring it keeps controller and
+  // game_snapshot after read_input
+  [Controller] = {"controller", (system_func)controller, false, 5, {
+    {DataAccessRef, &FiascoIds.Inputs},
+    {Query, NULL, 2, {MUT(FiascoIds.Camera), MUT(FiascoIds.Transform)}},
+    {DataAccessRef, &FiascoIds.Aspect},
+    {DataAccessRef, &FiascoIds.FrameConstants},
+    {Query, NULL, 4, {MUT(THUMB_ID), MUT(FiascoIds.Transform), MUT(FiascoIds.Color), MUT(FiascoIds.TextureRender)}},
+  }},
+  [AlignControlsText] = {"align_controls_text", (system_func)align_controls_text, false, 2, {
+    {Query, NULL, 2, {MUT(FiascoIds.Transform), REF(FiascoIds.TextRender)}},
+    {DataAccessRef, &FiascoIds.Aspect},
+  }},
+  [GameSnapshot] = {"game_snapshot", (system_func)game_snapshot, false, 4, {
+    {DataAccessRef, &FiascoIds.Inputs},
+    {Query, NULL, 2, {MUT(FiascoIds.Camera), MUT(FiascoIds.Transform)}},
+    {Query, NULL, 4, {MUT(THUMB_ID), MUT(FiascoIds.Transform), MUT(FiascoIds.Color), MUT(FiascoIds.TextureRender)}},
+    {DataAccessRef, &FiascoIds.FrameConstants},
+  }},
+  [FlushCommands] = {"flush_commands", (system_func)flush_commands, false, 0},
+};
+
+// 0 until checked, then 1 if the table is valid and -1 if not
+int system_table_state = 0;
+
+const SystemArg* system_arg(size_t system_index, size_t arg_index) {
+  if (system_index >= SystemsCount) return NULL;
+  if (arg_index >= system_table[system_index].args_len) return NULL;
+  return &system_table[system_index].args[arg_index];
 }
 
-bool system_is_once(size_t system_index) {
-  printf("system_is_once called %zu\n", system_index);
+const QueryComponent* system_query_component(size_t system_index, size_t arg_index, size_t query_index) {
+  const SystemArg *arg = system_arg(system_index, arg_index);
+  if (arg == NULL || arg->type != Query || query_index >= arg->query_len) return NULL;
+  return &arg->query[query_index];
+}
 
-  if (system_index == ThumbMover) return false;
-  if (system_index == ThumbSpawnerOnce) return true;
-  if (system_index == Controller) return false;
-  if (system_index == AlignControlsText) return false;
+// An invalid table registers no systems rather than half of them
+size_t systems_len() {
+  log_trace("systems_len called");
 
-  return false;
+  if (system_table_state == 0) {
+    system_table_state = validate_systems(system_table, SystemsCount) ? 1 : -1;
+  }
+  return system_table_state > 0 ? SystemsCount : 0;
 }
 
-char* system_name(size_t system_index) {
-  printf("system_name called %zu\n", system_index);
-
-  if (system_index == ThumbMover) return "thumb_mover";
-  if (system_index == ThumbSpawnerOnce) return "thumb_spawner_once";
-  if (system_index == Controller) return "controller";
-  if (system_index == AlignControlsText) return "align_controls_text";
+bool system_is_once(size_t system_index) {
+  log_trace("system_is_once called %zu", system_index);
+  return system_index < SystemsCount && system_table[system_index].once;
+}
 
-  return NULL;
+char* system_name(size_t system_index) {
+  log_trace("system_name called %zu", system_index);
+  return system_index < SystemsCount ? (char*)system_table[system_index].name : NULL;
 }
 
 system_func system_fn(size_t system_index) {
-  printf("system_fn called %zu\n", system_index);
-
-  if (system_index == ThumbMover) return (system_func)thumb_mover;
-  if (system_index == ThumbSpawnerOnce) return (system_func)thumb_spawner_once;
-  if (system_index == Controller) return (system_func)controller;
-  if (system_index == AlignControlsText) return (system_func)align_controls_text;
-
-  return NULL;
+  log_trace("system_fn called %zu", system_index);
+  if (system_index >= SystemsCount) return NULL;
+  return profiler_wrap(system_index, system_table[system_index].name, system_table[system_index].fn);
 }
 
 size_t system_args_len(size_t system_index) {
-  printf("system_args_len called %zu\n", system_index);
-
-  if (system_index == ThumbMover) return 3;
-  if (system_index == ThumbSpawnerOnce) return 3;
-  if (system_index == Controller) return 5;
-  if (system_index == AlignControlsText) return 2;
-
-  return 0;
+  log_trace("system_args_len called %zu", system_index);
+  return system_index < SystemsCount ? system_table[system_index].args_len : 0;
 }
 
 ArgType system_arg_type(size_t system_index, size_t arg_index) {
-  printf("system_arg_type called %zu - %zu\n", system_index, arg_index);
-  
-  if (system_index == ThumbMover) {
-    if (arg_index == 0) return Query; // Query<Thumb, Transform, ColorRender>
-    if (arg_index == 1) return DataAccessRef; // FrameConstants
-    if (arg_index == 2) return DataAccessRef; // Aspect
-  }
-
-  if (system_index == ThumbSpawnerOnce) {
-    if (arg_index == 0) return DataAccessRef; // Aspect
-    if (arg_index == 1) return DataAccessRef; // GpuInterface
-    if (arg_index == 2) return EventWriter; // EventWriter<NewTexture> 
-  }
-
-  if (system_index == Controller) {
-    if (arg_index == 0) return DataAccessRef; // Input
-    if (arg_index == 1) return Query; // Query<Camera, Transform>
-    if (arg_index == 2) return DataAccessRef; // Aspect
-    if (arg_index == 3) return DataAccessRef; // FrameConstants
-    if (arg_index == 4) return Query; // Query<TextureRender>
-  }
-
-  if (system_index == AlignControlsText) {
-    if (arg_index == 0) return Query; // Query<Transform, TextRender>
-    if (arg_index == 1) return DataAccessRef; // Aspect
-  }
-  
-  return Query;
+  log_trace("system_arg_type called %zu - %zu", system_index, arg_index);
+  const SystemArg *arg = system_arg(system_index, arg_index);
+  return arg != NULL ? arg->type : Query;
 }
 
 char* system_arg_component(size_t system_index, size_t arg_index) {
-  printf("system_arg_component called %zu - %zu\n", system_index, arg_index);
-  
-  if (system_index == ThumbMover) {
-    // 0 - Query<Thumb, Transform, ColorRender>
-    if (arg_index == 1) return FiascoIds.FrameConstants;
-    if (arg_index == 2) return FiascoIds.Aspect;
-  }
-
-  if (system_index == ThumbSpawnerOnce) {
-    if (arg_index == 0) return FiascoIds.Aspect;
-    if (arg_index == 1) return FiascoIds.GpuInterface;
-  }
-
-  if (system_index == Controller) {
-    if (arg_index == 0) return FiascoIds.Inputs;
-    // 1 - Query<Camera, Transform>
-    if (arg_index == 2) return FiascoIds.Aspect;
-    if (arg_index == 3) return FiascoIds.FrameConstants;
-    // 4 - Query<TextureRender>
-  }
-
-  if (system_index == AlignControlsText) {
-    // 0 - Query<Transform, TextRender>
-    if (arg_index == 1) return FiascoIds.Aspect;
-  }
-  
-  return NULL;
+  log_trace("system_arg_component called %zu - %zu", system_index, arg_index);
+  const SystemArg *arg = system_arg(system_index, arg_index);
+  if (arg == NULL || (arg->type != DataAccessRef && arg->type != DataAccessMut)) return NULL;
+  return *arg->id;
 }
 
 char* system_arg_event(size_t system_index, size_t arg_index) {
-  printf("system_arg_event called %zu - %zu\n", system_index, arg_index);
-
-  if (system_index == ThumbSpawnerOnce) {
-    if (arg_index == 2) return FiascoEvents.NewTexture;
-  }
-
-  return NULL;
+  log_trace("system_arg_event called %zu - %zu", system_index, arg_index);
+  const SystemArg *arg = system_arg(system_index, arg_index);
+  if (arg == NULL || (arg->type != EventReader && arg->type != EventWriter)) return NULL;
+  return *arg->id;
 }
 
+// 0 for args that are not queries
 size_t system_query_args_len(size_t system_index, size_t arg_index) {
-  printf("system_query_args_len called %zu - %zu\n", system_index, arg_index);
-  
-  if (system_index == ThumbMover) {
-    if (arg_index == 0) return 3;
-  }
-
-  if (system_index == ThumbSpawnerOnce) {
-    // noop
-  }
-
-  if (system_index == Controller) {
-    if (arg_index == 1) return 2; 
-    if (arg_index == 4) return 1; 
-  }
-
-  if (system_index == AlignControlsText) {
-    if (arg_index == 0) return 2;
-  }
-  
-  return -1;
+  log_trace("system_query_args_len called %zu - %zu", system_index, arg_index);
+  const SystemArg *arg = system_arg(system_index, arg_index);
+  return arg != NULL && arg->type == Query ? arg->query_len : 0;
 }
 
 ArgType system_query_arg_type(size_t system_index, size_t arg_index, size_t query_index) {
-  printf("system_query_arg_type called %zu - %zu - %zu\n", system_index, arg_index, query_index);
-  return DataAccessMut;
+  log_trace("system_query_arg_type called %zu - %zu - %zu", system_index, arg_index, query_index);
+  const QueryComponent *component = system_query_component(system_index, arg_index, query_index);
+  return component != NULL ? component->access : DataAccessMut;
 }
 
 char* system_query_arg_component(size_t system_index, size_t arg_index, size_t query_index) {
-  printf("system_query_arg_component called %zu - %zu - %zu\n", system_index, arg_index, query_index);
-  
-  if (system_index == ThumbMover) {
-    if (arg_index == 0) {
-      if (query_index == 0) return THUMB_ID;
-      if (query_index == 1) return FiascoIds.Transform;
-      if (query_index == 2) return FiascoIds.Color;
-    }
-  }
-
-  if (system_index == ThumbSpawnerOnce) {
-    // noop
-  }
-
-  if (system_index == Controller) {
-    if (arg_index == 1) {
-      if (query_index == 0) return FiascoIds.Camera;
-      if (query_index == 1) return FiascoIds.Transform;
-    }
-    if (arg_index == 4) {
-      if (query_index == 0) return FiascoIds.TextureRender;
-    }
-  }
-
-  if (system_index == AlignControlsText) {
-    if (arg_index == 0) {
-      if (query_index == 0) return FiascoIds.Transform;
-      if (query_index == 1) return FiascoIds.TextRender;
-    }
-  }
-
-  return NULL;
+  log_trace("system_query_arg_component called %zu - %zu - %zu", system_index, arg_index, query_index);
+  const QueryComponent *component = system_query_component(system_index, arg_index, query_index);
+  return component != NULL ? *component->id : NULL;
 }
 
 void load_engine_proc_addrs(get_proc_addr get_proc) {
-  printf("load_engine_addrs called\n");
+  log_trace("load_engine_addrs called");
   engine.call = get_proc("call");
   engine.call_async = get_proc("call_async");
   engine.despawn = get_proc("despawn");
@@ -677,24 +1717,49 @@ void load_engine_proc_addrs(get_proc_addr get_proc) {
   engine.texture_asset_manager_is_id_loaded = get_proc("texture_asset_manager_is_id_loaded");
   engine.texture_asset_manager_load_texture = get_proc("texture_asset_manager_load_texture");
   engine.gpu_interface_get_texture_asset_manager_mut = get_proc("gpu_interface_get_texture_asset_manager_mut");
+
+  // with FIASCO_FFI set, every engine call is counted and timed
+  ffi_wrap_engine(&engine);
+  // with FIASCO_TRACE set, every parallel query records worker spans
+  engine.query_par_for_each = trace_wrap_par_for_each(engine.query_par_for_each);
 }
 
 char* component_async_completion_callable(const char *string_id) {
-  printf("component_async_completion_callable called %s\n", string_id);
+  log_trace("component_async_completion_callable called %s", string_id);
   return NULL;
 }
 
 int resource_init(char *string_id, void *val) {
-  printf("resource_init called %s\n", string_id);
+  log_trace("resource_init called %s", string_id);
+  if (strcmp(string_id, GAME_STATE_ID) == 0) {
+    memset(val, 0, sizeof(GameState));
+  }
   return 0;
 }
 
+// The restore itself happens in game_snapshot on the next frame
 int resource_deserialize(char *string_id, void *val, void *reader, read_t read) {
-  printf("resource_deserialize called\n");
+  log_trace("resource_deserialize called %s", string_id);
+  if (strcmp(string_id, GAME_STATE_ID) != 0) return 0;
+
+  if (!load_game(&game_capture, reader, read)) {
+    game_capture.state = CaptureNone;
+    return 1;
+  }
+  game_capture.state = CaptureRestorePending;
+  if (val != NULL) ((GameState*)val)->thumbs = (uint32_t)game_capture.len;
   return 0;
 }
 
+// Writes the last F5 capture; without one there is nothing to save
 int resource_serialize(char *string_id, void *val, void *writer, write_t write) {
-  printf("resource_serialize called\n");
-  return 0;
-}
\ No newline at end of file
+  log_trace("resource_serialize called %s", string_id);
+  if (strcmp(string_id, GAME_STATE_ID) != 0) return 0;
+
+  if (game_capture.state == CaptureNone) {
+    log_warn("No capture to save, press F5 first");
+    return 1;
+  }
+  if (val != NULL) ((GameState*)val)->thumbs = (uint32_t)game_capture.len;
+  return save_game(&game_capture, writer, write) ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+#include <string.h>
+#include <lz.h>
+
+#define LZ_HASH_BITS 14
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+// as in LZ4: the last match starts 12 bytes before the end and the last 5
+// bytes are always literals
+#define LZ_MATCH_LIMIT 12
+#define LZ_LAST_LITERALS 5
+
+static inline uint32_t lz_read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint32_t lz_hash(uint32_t value) {
+  return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t* lz_put_length(uint8_t *op, size_t len) {
+  for (; len >= 255; len -= 255) *op++ = 255;
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+static uint8_t* lz_put_literals(uint8_t *op, const uint8_t *literals, size_t len, size_t match) {
+  *op++ = (uint8_t)((len >= 15 ? 15 : len) << 4 | (match >= 15 ? 15 : match));
+  if (len >= 15) op = lz_put_length(op, len - 15);
+  memcpy(op, literals, len);
+  return op + len;
+}
+
+size_t lz_bound(size_t len) {
+  return len + len / 255 + 16;
+}
+
+size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst) {
+  uint32_t table[1 << LZ_HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  const uint8_t *end = src + len;
+  uint8_t *op = dst;
+
+  if (len > LZ_MATCH_LIMIT) {
+    const uint8_t *match_limit = end - LZ_MATCH_LIMIT;
+    const uint8_t *match_end = end - LZ_LAST_LITERALS;
+
+    while (ip < match_limit) {
+      uint32_t sequence = lz_read32(ip);
+      uint32_t *slot = &table[lz_hash(sequence)];
+      const uint8_t *ref = src + *slot;
+      *slot = (uint32_t)(ip - src);
+
+      if (ref >= ip || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != sequence) {
+        // step further the longer nothing has matched, as LZ4 does
+        ip += 1 + ((size_t)(ip - anchor) >> 6);
+        continue;
+      }
+
+      while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+        ip--;
+        ref--;
+      }
+
+      const uint8_t *mp = ip + LZ_MIN_MATCH;
+      const uint8_t *mr = ref + LZ_MIN_MATCH;
+      while (mp + 8 <= match_end) {
+        uint64_t a, b;
+        memcpy(&a, mp, sizeof(a));
+        memcpy(&b, mr, sizeof(b));
+        if (a != b) break;
+        mp += 8;
+        mr += 8;
+      }
+      while (mp < match_end && *mp == *mr) {
+        mp++;
+        mr++;
+      }
+
+      size_t match = (size_t)(mp - ip) - LZ_MIN_MATCH;
+      size_t offset = (size_t)(ip - ref);
+      op = lz_put_literals(op, anchor, (size_t)(ip - anchor), match);
+      *op++ = (uint8_t)offset;
+      *op++ = (uint8_t)(offset >> 8);
+      if (match >= 15) op = lz_put_length(op, match - 15);
+
+      ip = mp;
+      anchor = ip;
+    }
+  }
+
+  op = lz_put_literals(op, anchor, (size_t)(end - anchor), 0);
+  return (size_t)(op - dst);
+}
+
+static bool lz_get_length(const uint8_t **ip, const uint8_t *end, size_t *len) {
+  uint8_t byte;
+  do {
+    if (*ip >= end) return false;
+    byte = *(*ip)++;
+    *len += byte;
+  } while (byte == 255);
+  return true;
+}
+
+bool lz_decompress(const uint8_t *src, size_t src_len, uint8_t *dst, size_t len) {
+  const uint8_t *ip = src;
+  const uint8_t *end = src + src_len;
+  uint8_t *op = dst;
+  uint8_t *op_end = dst + len;
+
+  while (ip < end) {
+    uint8_t token = *ip++;
+
+    size_t literals = token >> 4;
+    if (literals == 15 && !lz_get_length(&ip, end, &literals)) return false;
+    if (literals > (size_t)(end - ip) || literals > (size_t)(op_end - op)) return false;
+    memcpy(op, ip, literals);
+    op += literals;
+    ip += literals;
+    if (ip == end) break; // the last sequence has no match
+
+    if (end - ip < 2) return false;
+    size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+    ip += 2;
+    size_t match = token & 15;
+    if (match == 15 && !lz_get_length(&ip, end, &match)) return false;
+    match += LZ_MIN_MATCH;
+    if (offset == 0 || offset > (size_t)(op - dst) || match > (size_t)(op_end - op)) return false;
+
+    const uint8_t *ref = op - offset;
+    if (offset == 1) {
+      memset(op, *ref, match);
+    } else if (offset >= match) {
+      memcpy(op, ref, match);
+    } else {
+      for (size_t i = 0; i < match; i++) op[i] = ref[i];
+    }
+    op += match;
+  }
+
+  return op == op_end;
+}
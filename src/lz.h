@@ -0,0 +1,19 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Byte-oriented LZ77 in the LZ4 block layout: sequences of a token (literal
+// count, match length - 4), literals, a 16-bit offset and length extension
+// bytes. Greedy, one hash probe per position and no entropy stage, so it
+// runs at memory speed on the long zero runs an XOR delta is made of.
+
+size_t lz_bound(size_t len);
+// `dst` must hold lz_bound(len) bytes; returns the compressed size
+size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst);
+// True only if `src` is well formed and decodes to exactly `len` bytes
+bool lz_decompress(const uint8_t *src, size_t src_len, uint8_t *dst, size_t len);
+
+#endif
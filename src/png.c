@@ -0,0 +1,581 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_HASH_BITS 15
+
+static const uint8_t png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+static const uint16_t length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67,
+                                         83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5,
+                                         5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                       1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11,
+                                       11, 12, 12, 13, 13};
+
+bool image_alloc(Image *image, uint32_t width, uint32_t height) {
+  image->width = width;
+  image->height = height;
+  image->pixels = (uint8_t*)calloc((size_t)width * height, 4);
+  return image->pixels != NULL || (size_t)width * height == 0;
+}
+
+void image_free(Image *image) {
+  free(image->pixels);
+  memset(image, 0, sizeof(Image));
+}
+
+// CHECKSUMS
+
+// PNG's CRC-32 (the zlib polynomial), not snapshot's CRC32C
+static uint32_t png_crc(uint32_t crc, const uint8_t *data, size_t len) {
+  static uint32_t table[256];
+  if (table[1] == 0) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+  }
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static uint32_t adler32(const uint8_t *data, size_t len) {
+  uint32_t a = 1, b = 0;
+  while (len > 0) {
+    // 5552 bytes is the most that can't overflow before the modulo
+    size_t run = len < 5552 ? len : 5552;
+    for (size_t i = 0; i < run; i++) {
+      a += data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    data += run;
+    len -= run;
+  }
+  return b << 16 | a;
+}
+
+static uint32_t get_u32_be(const uint8_t *in) {
+  return (uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 8 | in[3];
+}
+
+static void put_u32_be(uint8_t *out, uint32_t value) {
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+}
+
+// INFLATE
+
+typedef struct {
+  const uint8_t *in;
+  size_t len;
+  size_t pos;
+  uint32_t bits;
+  int count;
+  uint8_t *out;
+  size_t out_len;
+  size_t out_pos;
+  bool failed;
+} Inflate;
+
+#define HUFFMAN_FAST 9
+
+typedef struct {
+  int16_t count[16]; // codes of each length
+  int16_t symbol[288]; // symbols ordered by code
+  uint16_t fast[1 << HUFFMAN_FAST]; // symbol << 4 | length by the next bits, 0 for longer codes
+} Huffman;
+
+static int take_bits(Inflate *s, int n) {
+  uint32_t bits = s->bits;
+  while (s->count < n) {
+    if (s->pos >= s->len) {
+      s->failed = true;
+      return 0;
+    }
+    bits |= (uint32_t)s->in[s->pos++] << s->count;
+    s->count += 8;
+  }
+  s->bits = bits >> n;
+  s->count -= n;
+  return (int)(bits & ((1u << n) - 1));
+}
+
+// Canonical codes from their lengths. Incomplete sets are allowed, since a
+// block with a single distance code has one; over-subscribed ones are not.
+static bool huffman_build(Huffman *h, const uint8_t *lengths, int n) {
+  memset(h->count, 0, sizeof(h->count));
+  for (int s = 0; s < n; s++) h->count[lengths[s]]++;
+
+  int left = 1;
+  for (int len = 1; len < 16; len++) {
+    left = (left << 1) - h->count[len];
+    if (left < 0) return false;
+  }
+
+  int16_t offsets[16];
+  offsets[1] = 0;
+  for (int len = 1; len < 15; len++) offsets[len + 1] = (int16_t)(offsets[len] + h->count[len]);
+  for (int s = 0; s < n; s++) {
+    if (lengths[s] != 0) h->symbol[offsets[lengths[s]]++] = (int16_t)s;
+  }
+
+  // codes are read from their first bit, so the table is indexed bit-reversed
+  memset(h->fast, 0, sizeof(h->fast));
+  int code = 0, index = 0;
+  for (int len = 1; len <= HUFFMAN_FAST; len++, code <<= 1) {
+    for (int c = 0; c < h->count[len]; c++, code++, index++) {
+      int reversed = 0;
+      for (int b = 0; b < len; b++) reversed |= (code >> b & 1) << (len - 1 - b);
+      for (int fill = reversed; fill < 1 << HUFFMAN_FAST; fill += 1 << len) {
+        h->fast[fill] = (uint16_t)(h->symbol[index] << 4 | len);
+      }
+    }
+  }
+  return true;
+}
+
+// Short codes come from the table, longer ones a bit at a time
+static int huffman_decode(Inflate *s, const Huffman *h) {
+  while (s->count < HUFFMAN_FAST && s->pos < s->len) {
+    s->bits |= (uint32_t)s->in[s->pos++] << s->count;
+    s->count += 8;
+  }
+  uint16_t entry = h->fast[s->bits & ((1u << HUFFMAN_FAST) - 1)];
+  if (entry != 0 && (entry & 15) <= s->count) {
+    s->bits >>= entry & 15;
+    s->count -= entry & 15;
+    return entry >> 4;
+  }
+
+  int code = 0, first = 0, index = 0;
+  for (int len = 1; len < 16; len++) {
+    code |= take_bits(s, 1);
+    int count = h->count[len];
+    if (code - count < first) return h->symbol[index + (code - first)];
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+static bool inflate_stored(Inflate *s) {
+  // give back the whole bytes the decoder read ahead
+  s->pos -= (size_t)(s->count / 8);
+  s->bits = 0;
+  s->count = 0;
+  if (s->len - s->pos < 4) return false;
+  size_t len = s->in[s->pos] | (size_t)s->in[s->pos + 1] << 8;
+  size_t check = s->in[s->pos + 2] | (size_t)s->in[s->pos + 3] << 8;
+  s->pos += 4;
+  if (len != (~check & 0xffff) || s->len - s->pos < len || s->out_len - s->out_pos < len) return false;
+  memcpy(s->out + s->out_pos, s->in + s->pos, len);
+  s->pos += len;
+  s->out_pos += len;
+  return true;
+}
+
+static bool inflate_codes(Inflate *s, const Huffman *lengths, const Huffman *distances) {
+  for (;;) {
+    int symbol = huffman_decode(s, lengths);
+    if (symbol < 0 || s->failed) return false;
+    if (symbol < 256) {
+      if (s->out_pos == s->out_len) return false;
+      s->out[s->out_pos++] = (uint8_t)symbol;
+      continue;
+    }
+    if (symbol == 256) return true;
+
+    symbol -= 257;
+    if (symbol >= 29) return false;
+    size_t len = length_base[symbol] + take_bits(s, length_extra[symbol]);
+    int code = huffman_decode(s, distances);
+    if (code < 0 || code >= 30) return false;
+    size_t dist = dist_base[code] + take_bits(s, dist_extra[code]);
+    if (s->failed || dist > s->out_pos || s->out_len - s->out_pos < len) return false;
+
+    // overlapping copies repeat the last `dist` bytes, so those go byte by byte
+    uint8_t *out = s->out + s->out_pos;
+    if (dist >= len) {
+      memcpy(out, out - dist, len);
+    } else if (dist == 1) {
+      memset(out, out[-1], len);
+    } else {
+      for (size_t i = 0; i < len; i++) out[i] = out[(ptrdiff_t)i - (ptrdiff_t)dist];
+    }
+    s->out_pos += len;
+  }
+}
+
+static bool inflate_fixed(Inflate *s) {
+  static Huffman lengths, distances;
+  static bool built = false;
+  if (!built) {
+    uint8_t bits[288];
+    for (int i = 0; i < 288; i++) bits[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    huffman_build(&lengths, bits, 288);
+    for (int i = 0; i < 30; i++) bits[i] = 5;
+    huffman_build(&distances, bits, 30);
+    built = true;
+  }
+  return inflate_codes(s, &lengths, &distances);
+}
+
+static bool inflate_dynamic(Inflate *s) {
+  static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  int nlen = take_bits(s, 5) + 257;
+  int ndist = take_bits(s, 5) + 1;
+  int ncode = take_bits(s, 4) + 4;
+  if (s->failed || nlen > 286 || ndist > 30) return false;
+
+  uint8_t bits[288 + 30] = {0};
+  for (int i = 0; i < ncode; i++) bits[order[i]] = (uint8_t)take_bits(s, 3);
+  Huffman lengths, distances;
+  if (s->failed || !huffman_build(&lengths, bits, 19)) return false;
+
+  for (int i = 0; i < nlen + ndist;) {
+    int symbol = huffman_decode(s, &lengths);
+    if (symbol < 0) return false;
+    if (symbol < 16) {
+      bits[i++] = (uint8_t)symbol;
+      continue;
+    }
+    uint8_t value = 0;
+    int repeat;
+    if (symbol == 16) {
+      if (i == 0) return false;
+      value = bits[i - 1];
+      repeat = 3 + take_bits(s, 2);
+    } else if (symbol == 17) {
+      repeat = 3 + take_bits(s, 3);
+    } else {
+      repeat = 11 + take_bits(s, 7);
+    }
+    if (s->failed || i + repeat > nlen + ndist) return false;
+    while (repeat-- > 0) bits[i++] = value;
+  }
+
+  // a block without an end code could never finish
+  if (bits[256] == 0) return false;
+  if (!huffman_build(&lengths, bits, nlen) || !huffman_build(&distances, bits + nlen, ndist)) return false;
+  return inflate_codes(s, &lengths, &distances);
+}
+
+bool zlib_inflate(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len) {
+  if (in_len < 6 || (in[0] & 0x0f) != 8 || (in[0] << 8 | in[1]) % 31 != 0 || (in[1] & 0x20) != 0) return false;
+
+  Inflate s;
+  memset(&s, 0, sizeof(Inflate));
+  s.in = in;
+  s.len = in_len;
+  s.pos = 2;
+  s.out = out;
+  s.out_len = out_len;
+
+  int last;
+  do {
+    last = take_bits(&s, 1);
+    int type = take_bits(&s, 2);
+    bool ok = false;
+    if (type == 0) ok = inflate_stored(&s);
+    else if (type == 1) ok = inflate_fixed(&s);
+    else if (type == 2) ok = inflate_dynamic(&s);
+    if (!ok || s.failed) return false;
+  } while (!last);
+
+  // the checksum starts at the next whole byte
+  s.pos -= (size_t)(s.count / 8);
+  if (s.out_pos != out_len || s.len - s.pos < 4) return false;
+  return get_u32_be(in + s.pos) == adler32(out, out_len);
+}
+
+// DEFLATE
+
+typedef struct {
+  uint8_t *out;
+  size_t pos;
+  uint64_t bits;
+  int count;
+} BitWriter;
+
+static void put_bits(BitWriter *w, uint32_t value, int n) {
+  w->bits |= (uint64_t)value << w->count;
+  w->count += n;
+  while (w->count >= 8) {
+    w->out[w->pos++] = (uint8_t)w->bits;
+    w->bits >>= 8;
+    w->count -= 8;
+  }
+}
+
+// Huffman codes go out most significant bit first
+static void put_code(BitWriter *w, uint32_t code, int n) {
+  uint32_t reversed = 0;
+  for (int i = 0; i < n; i++) reversed |= ((code >> i) & 1) << (n - 1 - i);
+  put_bits(w, reversed, n);
+}
+
+static void put_symbol(BitWriter *w, int symbol) {
+  if (symbol < 144) put_code(w, 0x30 + symbol, 8);
+  else if (symbol < 256) put_code(w, 0x190 + symbol - 144, 9);
+  else if (symbol < 280) put_code(w, symbol - 256, 7);
+  else put_code(w, 0xc0 + symbol - 280, 8);
+}
+
+static void put_match(BitWriter *w, size_t len, size_t dist) {
+  int l = 28;
+  while (length_base[l] > len) l--;
+  put_symbol(w, 257 + l);
+  put_bits(w, (uint32_t)(len - length_base[l]), length_extra[l]);
+
+  int d = 29;
+  while (dist_base[d] > dist) d--;
+  put_code(w, d, 5);
+  put_bits(w, (uint32_t)(dist - dist_base[d]), dist_extra[d]);
+}
+
+static inline uint32_t hash3(const uint8_t *p) {
+  return ((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u >> (32 - DEFLATE_HASH_BITS);
+}
+
+size_t zlib_bound(size_t len) {
+  // a literal costs at most 9 bits
+  return len + len / 8 + 16;
+}
+
+size_t zlib_deflate(const uint8_t *in, size_t len, uint8_t *out) {
+  // positions + 1, so 0 is empty
+  uint32_t *head = (uint32_t*)calloc((size_t)1 << DEFLATE_HASH_BITS, sizeof(uint32_t));
+  if (head == NULL) return 0;
+
+  BitWriter w = {out, 0, 0, 0};
+  out[w.pos++] = 0x78; // deflate, 32K window
+  out[w.pos++] = 0x01;
+  put_bits(&w, 1, 1); // last block
+  put_bits(&w, 1, 2); // fixed codes
+
+  for (size_t i = 0; i < len;) {
+    size_t best = 0, dist = 0;
+    if (len - i >= DEFLATE_MIN_MATCH) {
+      uint32_t h = hash3(in + i);
+      size_t candidate = head[h];
+      head[h] = (uint32_t)(i + 1);
+      if (candidate != 0 && i - (candidate - 1) <= DEFLATE_WINDOW) {
+        const uint8_t *match = in + candidate - 1;
+        size_t limit = len - i < DEFLATE_MAX_MATCH ? len - i : DEFLATE_MAX_MATCH;
+        while (best < limit && match[best] == in[i + best]) best++;
+        dist = i - (candidate - 1);
+      }
+    }
+
+    if (best < DEFLATE_MIN_MATCH) {
+      put_symbol(&w, in[i++]);
+      continue;
+    }
+    put_match(&w, best, dist);
+    // positions inside the match stay findable for later ones
+    for (size_t end = i + best, j = i + 1; j < end && len - j >= DEFLATE_MIN_MATCH; j++) {
+      head[hash3(in + j)] = (uint32_t)(j + 1);
+    }
+    i += best;
+  }
+
+  put_symbol(&w, 256);
+  if (w.count > 0) put_bits(&w, 0, 8 - w.count);
+  put_u32_be(out + w.pos, adler32(in, len));
+  free(head);
+  return w.pos + 4;
+}
+
+// PNG
+
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+  int p = a + b - c;
+  int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  return pb <= pc ? b : c;
+}
+
+// Undoes the per-row filters in place; rows are 1 filter byte + `row` bytes
+static bool unfilter(uint8_t *raw, uint32_t height, size_t row, size_t bpp) {
+  const uint8_t *prior = NULL;
+  for (uint32_t y = 0; y < height; y++) {
+    uint8_t filter = raw[y * (row + 1)];
+    uint8_t *line = raw + y * (row + 1) + 1;
+    for (size_t x = 0; x < row; x++) {
+      uint8_t a = x >= bpp ? line[x - bpp] : 0;
+      uint8_t b = prior != NULL ? prior[x] : 0;
+      uint8_t c = prior != NULL && x >= bpp ? prior[x - bpp] : 0;
+      switch (filter) {
+        case 0: break;
+        case 1: line[x] += a; break;
+        case 2: line[x] += b; break;
+        case 3: line[x] += (uint8_t)((a + b) / 2); break;
+        case 4: line[x] += paeth(a, b, c); break;
+        default: return false;
+      }
+    }
+    prior = line;
+  }
+  return true;
+}
+
+static uint8_t* read_file(const char *path, size_t *len) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = size > 0 ? (uint8_t*)malloc((size_t)size) : NULL;
+  if (data != NULL && fread(data, 1, (size_t)size, file) != (size_t)size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  *len = (size_t)size;
+  return data;
+}
+
+bool png_read(const char *path, Image *image) {
+  memset(image, 0, sizeof(Image));
+  size_t len = 0;
+  uint8_t *data = read_file(path, &len);
+  if (data == NULL) return false;
+
+  bool ok = len >= 8 && memcmp(data, png_signature, 8) == 0;
+  uint32_t width = 0, height = 0;
+  uint8_t depth = 0, color = 0, interlace = 0;
+  uint8_t palette[256 * 4];
+  size_t palette_len = 0;
+  memset(palette, 0xff, sizeof(palette));
+  uint8_t *idat = NULL;
+  size_t idat_len = 0;
+
+  for (size_t pos = 8; ok && pos + 12 <= len;) {
+    uint32_t chunk = get_u32_be(data + pos);
+    const uint8_t *type = data + pos + 4;
+    const uint8_t *body = type + 4;
+    if (chunk > len - pos - 12 || get_u32_be(body + chunk) != png_crc(0, type, chunk + 4)) {
+      ok = false;
+      break;
+    }
+
+    if (memcmp(type, "IHDR", 4) == 0 && chunk >= 13) {
+      width = get_u32_be(body);
+      height = get_u32_be(body + 4);
+      depth = body[8];
+      color = body[9];
+      interlace = body[12];
+    } else if (memcmp(type, "PLTE", 4) == 0) {
+      palette_len = chunk / 3 < 256 ? chunk / 3 : 256;
+      for (size_t i = 0; i < palette_len; i++) memcpy(palette + 4 * i, body + 3 * i, 3);
+    } else if (memcmp(type, "tRNS", 4) == 0 && color == 3) {
+      for (size_t i = 0; i < chunk && i < 256; i++) palette[4 * i + 3] = body[i];
+    } else if (memcmp(type, "IDAT", 4) == 0) {
+      uint8_t *grown = (uint8_t*)realloc(idat, idat_len + chunk);
+      if (grown == NULL) {
+        ok = false;
+        break;
+      }
+      idat = grown;
+      memcpy(idat + idat_len, body, chunk);
+      idat_len += chunk;
+    } else if (memcmp(type, "IEND", 4) == 0) {
+      break;
+    }
+    pos += 12 + chunk;
+  }
+
+  static const uint8_t channels_of[7] = {1, 0, 3, 1, 2, 0, 4};
+  size_t channels = color <= 6 ? channels_of[color] : 0;
+  size_t bytes = depth == 16 && color != 3 ? 2 : 1;
+  if (ok && (channels == 0 || (depth != 8 && bytes == 1) || interlace != 0 || width == 0 || height == 0 ||
+             (color == 3 && palette_len == 0))) {
+    log_warn("%s: only non-interlaced 8 and 16-bit PNGs are supported", path);
+    ok = false;
+  }
+
+  size_t row = width * channels * bytes;
+  uint8_t *raw = ok ? (uint8_t*)malloc((row + 1) * height) : NULL;
+  ok = ok && raw != NULL && zlib_inflate(idat, idat_len, raw, (row + 1) * height) &&
+       unfilter(raw, height, row, channels * bytes) && image_alloc(image, width, height);
+
+  for (uint32_t y = 0; ok && y < height; y++) {
+    const uint8_t *in = raw + y * (row + 1) + 1;
+    uint8_t *out = image->pixels + (size_t)y * width * 4;
+    for (uint32_t x = 0; x < width; x++, out += 4) {
+      // 16-bit samples keep their high byte
+      const uint8_t *px = in + (size_t)x * channels * bytes;
+      uint8_t s[4];
+      for (size_t c = 0; c < channels; c++) s[c] = px[c * bytes];
+      switch (color) {
+        case 0: out[0] = out[1] = out[2] = s[0]; out[3] = 0xff; break;
+        case 2: out[0] = s[0]; out[1] = s[1]; out[2] = s[2]; out[3] = 0xff; break;
+        case 3: memcpy(out, palette + 4 * s[0], 4); break;
+        case 4: out[0] = out[1] = out[2] = s[0]; out[3] = s[1]; break;
+        default: memcpy(out, s, 4); break;
+      }
+    }
+  }
+
+  if (!ok) image_free(image);
+  free(raw);
+  free(idat);
+  free(data);
+  return ok;
+}
+
+static bool write_chunk(FILE *file, const char *type, const uint8_t *body, size_t len) {
+  uint8_t header[8];
+  put_u32_be(header, (uint32_t)len);
+  memcpy(header + 4, type, 4);
+  uint8_t crc[4];
+  put_u32_be(crc, png_crc(png_crc(0, (const uint8_t*)type, 4), body, len));
+  return fwrite(header, 1, 8, file) == 8 && fwrite(body, 1, len, file) == len && fwrite(crc, 1, 4, file) == 4;
+}
+
+// Rows are stored unfiltered: atlas sheets are mostly empty space and flat
+// sprite edges, which the match finder handles without help
+bool png_write(const char *path, const Image *image) {
+  size_t row = (size_t)image->width * 4;
+  size_t raw_len = (row + 1) * image->height;
+  uint8_t *raw = (uint8_t*)malloc(raw_len);
+  uint8_t *packed = raw != NULL ? (uint8_t*)malloc(zlib_bound(raw_len)) : NULL;
+  if (packed == NULL) {
+    free(raw);
+    return false;
+  }
+  for (uint32_t y = 0; y < image->height; y++) {
+    raw[y * (row + 1)] = 0;
+    memcpy(raw + y * (row + 1) + 1, image->pixels + y * row, row);
+  }
+  size_t packed_len = zlib_deflate(raw, raw_len, packed);
+
+  uint8_t ihdr[13] = {0};
+  put_u32_be(ihdr, image->width);
+  put_u32_be(ihdr + 4, image->height);
+  ihdr[8] = 8; // bit depth
+  ihdr[9] = 6; // RGBA
+
+  FILE *file = fopen(path, "wb");
+  bool ok = file != NULL && packed_len > 0 && fwrite(png_signature, 1, 8, file) == 8 &&
+            write_chunk(file, "IHDR", ihdr, sizeof(ihdr)) && write_chunk(file, "IDAT", packed, packed_len) &&
+            write_chunk(file, "IEND", NULL, 0);
+  if (file != NULL && fclose(file) != 0) ok = false;
+  free(raw);
+  free(packed);
+  return ok;
+}
@@ -0,0 +1,32 @@
+#ifndef PNG_H
+#define PNG_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+
+// Just enough PNG for the offline atlas packer, with no dependencies. Reads
+// non-interlaced 8-bit gray, gray+alpha, RGB, RGBA and palette images, and
+// 16-bit ones without a palette, into RGBA8. Writes RGBA8, deflated with the
+// fixed Huffman codes and a greedy single-candidate match finder.
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint8_t *pixels; // RGBA8, rows top to bottom, malloc'd
+} Image;
+
+bool image_alloc(Image *image, uint32_t width, uint32_t height);
+void image_free(Image *image);
+
+bool png_read(const char *path, Image *image);
+bool png_write(const char *path, const Image *image);
+
+// Inflates a zlib stream; true only when it fills `out` exactly
+bool zlib_inflate(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len);
+// Returns the stream's length; `out` must hold zlib_bound(len) bytes
+size_t zlib_deflate(const uint8_t *in, size_t len, uint8_t *out);
+size_t zlib_bound(size_t len);
+
+#endif
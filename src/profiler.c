@@ -0,0 +1,602 @@
+#include <stdlib.h>
+#include <string.h>
+#include <profiler.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+  #define PROFILER_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define PROFILER_TSC
+#endif
+
+// HISTOGRAM
+
+static inline int highest_bit(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return (int)index;
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+// Values below 2^(SUB_BITS + 1) index themselves; above, a value keeps its top
+// SUB_BITS + 1 bits and the shift picks the row
+static inline size_t histogram_index(uint64_t value) {
+  const uint64_t exact = 2 << HISTOGRAM_SUB_BITS;
+  if (value < exact) return (size_t)value;
+
+  int shift = highest_bit(value) - HISTOGRAM_SUB_BITS;
+  if (shift > HISTOGRAM_MAX_SHIFT) return HISTOGRAM_BUCKETS - 1;
+  uint64_t sub = (value >> shift) - (1 << HISTOGRAM_SUB_BITS);
+  return (size_t)(exact + (uint64_t)(shift - 1) * (1 << HISTOGRAM_SUB_BITS) + sub);
+}
+
+// Middle of the range of values that land in `index`
+static inline uint64_t histogram_value(size_t index) {
+  const size_t exact = 2 << HISTOGRAM_SUB_BITS;
+  if (index < exact) return index;
+
+  size_t shift = (index - exact) / (1 << HISTOGRAM_SUB_BITS) + 1;
+  uint64_t sub = (index - exact) % (1 << HISTOGRAM_SUB_BITS) + (1 << HISTOGRAM_SUB_BITS);
+  return (sub << shift) + ((1ull << shift) >> 1);
+}
+
+void histogram_record(LatencyHistogram *histogram, uint64_t value) {
+  atomic_add_u64(&histogram->buckets[histogram_index(value)], 1);
+  atomic_add_u64(&histogram->sum, value);
+
+  uint64_t max = atomic_load_u64(&histogram->max);
+  while (value > max && !atomic_cas_u64(&histogram->max, max, value)) {
+    max = atomic_load_u64(&histogram->max);
+  }
+}
+
+uint64_t histogram_count(const LatencyHistogram *histogram) {
+  uint64_t count = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) count += histogram->buckets[i];
+  return count;
+}
+
+uint64_t histogram_quantile(const LatencyHistogram *histogram, double quantile) {
+  uint64_t count = histogram_count(histogram);
+  if (count == 0) return 0;
+
+  uint64_t target = (uint64_t)(quantile * count + 0.5);
+  if (target < 1) target = 1;
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= target) {
+      uint64_t value = histogram_value(i);
+      return value < histogram->max ? value : histogram->max;
+    }
+  }
+  return histogram->max;
+}
+
+// PROFILER
+
+typedef struct {
+  const char *name;
+  system_func fn;
+  LatencyHistogram latency;
+} ProfiledSystem;
+
+typedef struct {
+  ProfiledSystem systems[PROFILER_MAX_SYSTEMS];
+  uint64_t start_ticks; // taken with start_ns when the first system is wrapped,
+  uint64_t start_ns;    // to convert ticks to ns at report time
+  bool profiling;
+  bool tracing;
+  LatencyHistogram deltas;
+  uint64_t frames; // profiler_frame is called from one system, so no atomics
+  float last_delta;
+  double jitter_sum; // sum of |delta - previous delta|, in seconds
+} Profiler;
+
+Profiler profiler;
+
+static uint64_t profiler_now_ns() {
+#ifdef _WIN32
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// The TSC is about half the cost of a clock_gettime call. Where there is none
+// a tick is a nanosecond.
+static inline uint64_t profiler_ticks() {
+#ifdef PROFILER_TSC
+  return __rdtsc();
+#else
+  return profiler_now_ns();
+#endif
+}
+
+static void profiler_start_clock() {
+  if (profiler.start_ns != 0) return;
+  profiler.start_ns = profiler_now_ns();
+  profiler.start_ticks = profiler_ticks();
+}
+
+static double profiler_ns_per_tick() {
+  uint64_t ticks = profiler_ticks() - profiler.start_ticks;
+  uint64_t ns = profiler_now_ns() - profiler.start_ns;
+  return ticks > 0 ? (double)ns / (double)ticks : 1.0;
+}
+
+static void trace_record(const char *name, const char *category, uint64_t start, uint64_t ticks);
+
+// System running on this thread, which names the worker spans it starts
+THREAD_LOCAL const char *trace_system;
+
+// Latencies are recorded in ticks and only scaled when reported
+static inline int profile_call(size_t index, const void **args) {
+  ProfiledSystem *system = &profiler.systems[index];
+  trace_system = system->name;
+  uint64_t start = profiler_ticks();
+  int code = system->fn(args);
+  uint64_t ticks = profiler_ticks() - start;
+  trace_system = NULL;
+
+  if (profiler.profiling) histogram_record(&system->latency, ticks);
+  if (profiler.tracing) trace_record(system->name, "system", start, ticks);
+  return code;
+}
+
+// The host calls a system with nothing but its args, so each slot needs a
+// function of its own that knows which system it times
+#define PROFILED(i) int profiled_##i(const void **args) { return profile_call(i, args); }
+PROFILED(0) PROFILED(1) PROFILED(2) PROFILED(3) PROFILED(4) PROFILED(5) PROFILED(6) PROFILED(7)
+PROFILED(8) PROFILED(9) PROFILED(10) PROFILED(11) PROFILED(12) PROFILED(13) PROFILED(14) PROFILED(15)
+
+const system_func profiled_fns[PROFILER_MAX_SYSTEMS] = {
+  profiled_0, profiled_1, profiled_2, profiled_3, profiled_4, profiled_5, profiled_6, profiled_7,
+  profiled_8, profiled_9, profiled_10, profiled_11, profiled_12, profiled_13, profiled_14, profiled_15,
+};
+
+// Read once from FIASCO_PROFILE=0|1; the host asks for system functions at load
+bool profiler_enabled() {
+  static int enabled = -1;
+  if (enabled >= 0) return enabled;
+
+  const char *env = getenv("FIASCO_PROFILE");
+  enabled = env != NULL && strcmp(env, "0") != 0;
+  return enabled;
+}
+
+// Shims are handed out when profiling, tracing or both
+system_func profiler_wrap(size_t index, const char *name, system_func fn) {
+  profiler.profiling = profiler_enabled();
+  profiler.tracing = trace_enabled();
+  if (fn == NULL || (!profiler.profiling && !profiler.tracing)) return fn;
+  if (index >= PROFILER_MAX_SYSTEMS) {
+    log_warn("profiler covers %d systems, %s runs untimed", PROFILER_MAX_SYSTEMS, name);
+    return fn;
+  }
+
+  profiler_start_clock();
+  profiler.systems[index].name = name;
+  profiler.systems[index].fn = fn;
+  return profiled_fns[index];
+}
+
+void profiler_frame(float delta) {
+  if (!profiler_enabled()) return;
+
+  if (profiler.frames > 0) {
+    profiler.jitter_sum += fabsf(delta - profiler.last_delta);
+  }
+  profiler.frames++;
+  profiler.last_delta = delta;
+  histogram_record(&profiler.deltas, (uint64_t)(delta * 1e9f));
+}
+
+// `us` is microseconds per recorded unit
+static void report_histogram(const char *name, const char *unit, const LatencyHistogram *histogram, double us) {
+  uint64_t count = histogram_count(histogram);
+  log_info("profile %-22s %8llu %-6s mean %9.2f us  p50 %9.2f  p99 %9.2f  p99.9 %9.2f  max %9.2f",
+           name, (unsigned long long)count, unit, histogram->sum * us / (double)count,
+           histogram_quantile(histogram, 0.5) * us, histogram_quantile(histogram, 0.99) * us,
+           histogram_quantile(histogram, 0.999) * us, histogram->max * us);
+}
+
+void profiler_report() {
+  if (!profiler_enabled()) return;
+
+  double us_per_tick = profiler_ns_per_tick() / 1e3;
+  for (size_t i = 0; i < PROFILER_MAX_SYSTEMS; i++) {
+    ProfiledSystem *system = &profiler.systems[i];
+    if (system->fn == NULL || histogram_count(&system->latency) == 0) continue;
+    report_histogram(system->name, "calls", &system->latency, us_per_tick);
+    memset(&system->latency, 0, sizeof(LatencyHistogram));
+  }
+
+  if (profiler.frames > 0) {
+    report_histogram("frame delta", "frames", &profiler.deltas, 1e-3);
+    double changes = profiler.frames > 1 ? (double)(profiler.frames - 1) : 1.0;
+    log_info("profile %-22s mean |delta change| %.2f us", "frame jitter", profiler.jitter_sum / changes * 1e6);
+  }
+  memset(&profiler.deltas, 0, sizeof(LatencyHistogram));
+  profiler.jitter_sum = 0;
+  profiler.frames = 0;
+}
+
+// TRACE
+
+typedef struct {
+  const char *name;
+  const char *category;
+  uint64_t start;
+  uint64_t ticks;
+} TraceEvent;
+
+typedef struct TraceBuffer TraceBuffer;
+
+// Only its own thread writes a buffer; trace_write reads them all
+struct TraceBuffer {
+  TraceBuffer *next;
+  uint32_t tid;
+  uint64_t written; // the ring holds the last TRACE_EVENTS of these
+  // query_par_for_each callbacks of one call merge into a single span per
+  // thread, which stays open until a callback from another call arrives
+  uint64_t open_call;
+  const char *open_name;
+  uint64_t open_start;
+  uint64_t open_end;
+  TraceEvent events[TRACE_EVENTS];
+};
+
+typedef struct {
+  TraceBuffer *volatile buffers;
+  volatile uint32_t threads;
+  volatile uint64_t calls; // numbers the traced query_par_for_each calls
+  volatile uint32_t generation; // bumped by trace_free so threads drop stale buffers
+  query_par_for_each_t par_for_each;
+  const char *path;
+} Tracer;
+
+Tracer tracer;
+THREAD_LOCAL TraceBuffer *trace_buffer;
+THREAD_LOCAL uint32_t trace_buffer_generation;
+
+// Read once from FIASCO_TRACE=<path>; registration is traced before init runs
+bool trace_enabled() {
+  static int enabled = -1;
+  if (enabled >= 0) return enabled;
+
+  tracer.path = getenv("FIASCO_TRACE");
+  enabled = tracer.path != NULL && tracer.path[0] != '\0';
+  if (enabled) profiler_start_clock();
+  return enabled;
+}
+
+// Registered once per thread with a lock-free push, like command segments
+static TraceBuffer* trace_thread_buffer() {
+  if (trace_buffer != NULL && trace_buffer_generation == tracer.generation) return trace_buffer;
+
+  TraceBuffer *buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+  if (buffer == NULL) return NULL;
+  buffer->tid = atomic_add_u32(&tracer.threads, 1) - 1;
+
+  do {
+    buffer->next = (TraceBuffer*)atomic_load_ptr((void *volatile *)&tracer.buffers);
+  } while (!atomic_cas_ptr((void *volatile *)&tracer.buffers, buffer->next, buffer));
+
+  trace_buffer = buffer;
+  trace_buffer_generation = tracer.generation;
+  return buffer;
+}
+
+static void trace_push(TraceBuffer *buffer, const char *name, const char *category, uint64_t start, uint64_t ticks) {
+  TraceEvent *event = &buffer->events[buffer->written % TRACE_EVENTS];
+  event->name = name;
+  event->category = category;
+  event->start = start;
+  event->ticks = ticks;
+  buffer->written++;
+}
+
+static void trace_close_open(TraceBuffer *buffer) {
+  if (buffer->open_name == NULL) return;
+  trace_push(buffer, buffer->open_name, "worker", buffer->open_start, buffer->open_end - buffer->open_start);
+  buffer->open_name = NULL;
+}
+
+static void trace_record(const char *name, const char *category, uint64_t start, uint64_t ticks) {
+  TraceBuffer *buffer = trace_thread_buffer();
+  if (buffer != NULL) trace_push(buffer, name, category, start, ticks);
+}
+
+uint64_t trace_begin() {
+  return trace_enabled() ? profiler_ticks() : 0;
+}
+
+void trace_end(const char *name, const char *category, uint64_t start) {
+  if (start == 0) return;
+  trace_record(name, category, start, profiler_ticks() - start);
+}
+
+typedef struct {
+  para_for_each_t fn;
+  const void *user_data;
+  const char *name;
+  uint64_t call;
+} TracedCallback;
+
+int traced_callback(const void **ids, const void *user_data) {
+  const TracedCallback *traced = (const TracedCallback*)user_data;
+  TraceBuffer *buffer = trace_thread_buffer();
+  if (buffer == NULL) return traced->fn(ids, traced->user_data);
+
+  uint64_t start = profiler_ticks();
+  int code = traced->fn(ids, traced->user_data);
+  if (buffer->open_call != traced->call || buffer->open_name == NULL) {
+    trace_close_open(buffer);
+    buffer->open_call = traced->call;
+    buffer->open_name = traced->name;
+    buffer->open_start = start;
+  }
+  buffer->open_end = profiler_ticks();
+  return code;
+}
+
+void traced_query_par_for_each(const void *query, para_for_each_t fn, const void *user_data) {
+  TracedCallback traced = {fn, user_data, trace_system != NULL ? trace_system : "query_par_for_each",
+                           atomic_add_u64(&tracer.calls, 1)};
+  uint64_t start = profiler_ticks();
+  tracer.par_for_each(query, traced_callback, &traced);
+
+  // the calling thread often runs callbacks too; end its span inside this one
+  if (trace_buffer != NULL && trace_buffer_generation == tracer.generation) trace_close_open(trace_buffer);
+  trace_end("query_par_for_each", "query", start);
+}
+
+query_par_for_each_t trace_wrap_par_for_each(query_par_for_each_t fn) {
+  if (fn == NULL || !trace_enabled()) return fn;
+  tracer.par_for_each = fn;
+  return traced_query_par_for_each;
+}
+
+const char* trace_path() {
+  return trace_enabled() ? tracer.path : NULL;
+}
+
+// Span and category names are identifiers, so they go out unescaped
+bool trace_write(const char *path) {
+  if (path == NULL) return false;
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    log_error("Could not open %s for the trace", path);
+    return false;
+  }
+
+  double us_per_tick = profiler_ns_per_tick() / 1e3;
+  size_t events = 0;
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+  TraceBuffer *buffer = (TraceBuffer*)atomic_load_ptr((void *volatile *)&tracer.buffers);
+  for (; buffer != NULL; buffer = buffer->next) {
+    trace_close_open(buffer);
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+            events++ > 0 ? ",\n" : "", buffer->tid, buffer->tid);
+
+    uint64_t first = buffer->written > TRACE_EVENTS ? buffer->written - TRACE_EVENTS : 0;
+    for (uint64_t i = first; i < buffer->written; i++) {
+      const TraceEvent *event = &buffer->events[i % TRACE_EVENTS];
+      double ts = (double)(int64_t)(event->start - profiler.start_ticks) * us_per_tick;
+      fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+              event->name, event->category, buffer->tid, ts, event->ticks * us_per_tick);
+      events++;
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+  bool ok = fclose(file) == 0;
+  log_info("trace: %zu events from %u threads written to %s", events, tracer.threads, path);
+  return ok;
+}
+
+// Drops every buffer; only safe once no thread will trace again
+void trace_free() {
+  TraceBuffer *buffer = (TraceBuffer*)atomic_load_ptr((void *volatile *)&tracer.buffers);
+  while (buffer != NULL) {
+    TraceBuffer *next = buffer->next;
+    free(buffer);
+    buffer = next;
+  }
+  tracer.buffers = NULL;
+  tracer.threads = 0;
+  tracer.generation++;
+}
+
+// FFI ACCOUNTING
+
+// R lists functions that return a value, V the void ones; every Engine
+// member appears once, in struct order
+#define ENGINE_CALLS(R, V) \
+  V(call, (ComponentId a, const void *b, size_t c), (a, b, c)) \
+  V(call_async, (ComponentId a, const void *b, size_t c, const void *d, size_t e), (a, b, c, d, e)) \
+  V(despawn, (EntityId a), (a)) \
+  R(event_count, size_t, (const void *a), (a)) \
+  R(event_get, const unsigned long*, (const void *a, size_t b), (a, b)) \
+  V(event_send, (const void *a, const char *b, size_t c), (a, b, c)) \
+  R(get_parent, bool, (EntityId a, unsigned long *b), (a, b)) \
+  V(set_parent, (EntityId a, EntityId b, bool c), (a, b, c)) \
+  V(set_system_enabled, (const char *a, bool b), (a, b)) \
+  R(spawn, EntityId, (const ComponentRef *a, size_t b), (a, b)) \
+  V(query_for_each, (const void *a, for_each_t b, const void *c), (a, b, c)) \
+  R(query_get, int, (const void *a, size_t b, const void **c), (a, b, c)) \
+  R(query_get_entity, int, (void *a, EntityId b, const void **c), (a, b, c)) \
+  R(query_len, size_t, (const void *a), (a)) \
+  V(query_par_for_each, (const void *a, para_for_each_t b, const void *c), (a, b, c)) \
+  V(add_components, (EntityId a, size_t b, const ComponentRef *c, size_t d), (a, b, c, d)) \
+  V(remove_components, (EntityId a, const ComponentId *b, size_t c), (a, b, c)) \
+  R(texture_asset_manager_white_texture_id, TextureId, (void), ()) \
+  R(texture_asset_manager_missing_texture_id, TextureId, (void), ()) \
+  R(texture_asset_manager_register_next_texture_id, TextureId, (void *a), (a)) \
+  R(texture_asset_manager_generate_hash, TextureHash, (const uint8_t *a, uint32_t b), (a, b)) \
+  R(texture_asset_manager_create_pending_texture, uint32_t, (TextureId a, const char *b, bool c, PendingTexture *d), (a, b, c, d)) \
+  V(texture_asset_manager_free_pending_texture, (PendingTexture *a), (a)) \
+  V(texture_asset_manager_free_engine_texture, (EngineTexture *a), (a)) \
+  V(texture_asset_manager_free_loaded_texture, (LoadedTexture *a), (a)) \
+  V(texture_asset_manager_free_failed_texture, (FailedTexture *a), (a)) \
+  R(texture_asset_manager_get_texture_type_by_id, TextureType, (void *a, TextureId b), (a, b)) \
+  R(texture_asset_manager_get_pending_texture_by_id, uint32_t, (void *a, TextureId b, PendingTexture *c), (a, b, c)) \
+  R(texture_asset_manager_get_engine_texture_by_id, uint32_t, (void *a, TextureId b, EngineTexture *c), (a, b, c)) \
+  R(texture_asset_manager_get_loaded_texture_by_id, uint32_t, (void *a, TextureId b, LoadedTexture *c), (a, b, c)) \
+  R(texture_asset_manager_get_failed_texture_by_id, uint32_t, (void *a, TextureId b, FailedTexture *c), (a, b, c)) \
+  R(texture_asset_manager_get_texture_type_by_path, TextureType, (void *a, const char *b), (a, b)) \
+  R(texture_asset_manager_get_pending_texture_by_path, uint32_t, (void *a, const char *b, PendingTexture *c), (a, b, c)) \
+  R(texture_asset_manager_get_engine_texture_by_path, uint32_t, (void *a, const char *b, EngineTexture *c), (a, b, c)) \
+  R(texture_asset_manager_get_loaded_texture_by_path, uint32_t, (void *a, const char *b, LoadedTexture *c), (a, b, c)) \
+  R(texture_asset_manager_get_failed_texture_by_path, uint32_t, (void *a, const char *b, FailedTexture *c), (a, b, c)) \
+  R(texture_asset_manager_are_ids_loaded, bool, (void *a, const TextureId *b, uint32_t c), (a, b, c)) \
+  R(texture_asset_manager_is_id_loaded, bool, (void *a, TextureId b), (a, b)) \
+  R(texture_asset_manager_load_texture, uint32_t, (void *a, const void *b, char *c, bool d, const PendingTexture *e), (a, b, c, d, e)) \
+  R(gpu_interface_get_texture_asset_manager_mut, void*, (void *a), (a))
+
+#define FFI_INDEX_R(name, ret, params, args) FfiCall_##name,
+#define FFI_INDEX_V(name, params, args) FfiCall_##name,
+typedef enum {
+  ENGINE_CALLS(FFI_INDEX_R, FFI_INDEX_V)
+  FfiCallsCount
+} FfiCall;
+
+#define FFI_NAME_R(name, ret, params, args) #name,
+#define FFI_NAME_V(name, params, args) #name,
+const char *ffi_names[FfiCallsCount] = {ENGINE_CALLS(FFI_NAME_R, FFI_NAME_V)};
+
+typedef struct {
+  volatile uint64_t calls;
+  volatile uint64_t ticks;
+} FfiCounter;
+
+typedef struct {
+  Engine real;
+  FfiCounter frame[FfiCallsCount]; // the open frame, written from any thread
+  FfiCounter last[FfiCallsCount];
+  FfiCounter total[FfiCallsCount];
+  uint64_t frames;
+  uint64_t report_every;
+} FfiAccounting;
+
+FfiAccounting ffi;
+
+static inline void ffi_account(FfiCall call, uint64_t start) {
+  atomic_add_u64(&ffi.frame[call].ticks, profiler_ticks() - start);
+  atomic_add_u64(&ffi.frame[call].calls, 1);
+}
+
+#define FFI_WRAP_R(name, ret, params, args) \
+  static ret ffi_##name params { \
+    uint64_t start = profiler_ticks(); \
+    ret result = ffi.real.name args; \
+    ffi_account(FfiCall_##name, start); \
+    return result; \
+  }
+#define FFI_WRAP_V(name, params, args) \
+  static void ffi_##name params { \
+    uint64_t start = profiler_ticks(); \
+    ffi.real.name args; \
+    ffi_account(FfiCall_##name, start); \
+  }
+ENGINE_CALLS(FFI_WRAP_R, FFI_WRAP_V)
+
+// Read once from FIASCO_FFI=0|1 and FIASCO_FFI_REPORT=<frames>
+bool ffi_enabled() {
+  static int enabled = -1;
+  if (enabled >= 0) return enabled;
+
+  const char *env = getenv("FIASCO_FFI");
+  enabled = env != NULL && strcmp(env, "0") != 0;
+  const char *every = getenv("FIASCO_FFI_REPORT");
+  ffi.report_every = every != NULL ? strtoull(every, NULL, 10) : 600;
+  return enabled;
+}
+
+// Pointers the engine did not provide stay NULL rather than becoming wrappers
+#define FFI_SWAP_R(name, ret, params, args) if (engine->name != NULL) engine->name = ffi_##name;
+#define FFI_SWAP_V(name, params, args) if (engine->name != NULL) engine->name = ffi_##name;
+void ffi_wrap_engine(Engine *engine) {
+  if (!ffi_enabled()) return;
+  profiler_start_clock();
+  ffi.real = *engine;
+  ENGINE_CALLS(FFI_SWAP_R, FFI_SWAP_V)
+}
+
+void ffi_frame() {
+  if (!ffi_enabled()) return;
+
+  for (size_t i = 0; i < FfiCallsCount; i++) {
+    ffi.last[i] = ffi.frame[i];
+    ffi.total[i].calls += ffi.frame[i].calls;
+    ffi.total[i].ticks += ffi.frame[i].ticks;
+    ffi.frame[i].calls = 0;
+    ffi.frame[i].ticks = 0;
+  }
+
+  ffi.frames++;
+  if (ffi.report_every > 0 && ffi.frames % ffi.report_every == 0) ffi_report();
+}
+
+static int compare_ffi_stats(const void *a, const void *b) {
+  double x = ((const FfiStat*)a)->ns;
+  double y = ((const FfiStat*)b)->ns;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static size_t ffi_collect(const FfiCounter *counters, FfiStat *out, size_t cap) {
+  FfiStat stats[FfiCallsCount];
+  double ns_per_tick = profiler_ns_per_tick();
+  size_t len = 0;
+
+  for (size_t i = 0; i < FfiCallsCount; i++) {
+    if (counters[i].calls == 0) continue;
+    stats[len++] = (FfiStat){ffi_names[i], counters[i].calls, counters[i].ticks * ns_per_tick};
+  }
+  qsort(stats, len, sizeof(FfiStat), compare_ffi_stats);
+
+  if (len > cap) len = cap;
+  memcpy(out, stats, len * sizeof(FfiStat));
+  return len;
+}
+
+size_t ffi_last_frame(FfiStat *out, size_t cap) {
+  return ffi_collect(ffi.last, out, cap);
+}
+
+size_t ffi_totals(FfiStat *out, size_t cap, uint64_t *frames) {
+  if (frames != NULL) *frames = ffi.frames;
+  return ffi_collect(ffi.total, out, cap);
+}
+
+void ffi_report() {
+  if (!ffi_enabled() || ffi.frames == 0) return;
+
+  FfiStat stats[FfiCallsCount];
+  uint64_t frames;
+  size_t len = ffi_totals(stats, FfiCallsCount, &frames);
+  log_info("ffi over %llu frames:", (unsigned long long)frames);
+  for (size_t i = 0; i < len; i++) {
+    log_info("ffi %-44s %12.1f calls/frame %9.1f ns/call %10.2f us/frame", stats[i].name,
+             (double)stats[i].calls / frames, stats[i].ns / stats[i].calls, stats[i].ns / frames / 1e3);
+  }
+}
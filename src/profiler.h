@@ -0,0 +1,82 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+
+// Per-system frame profiler, on when FIASCO_PROFILE=1. `profiler_wrap` then
+// hands the host a timing shim in place of each system function; when it is
+// off it returns the function itself, so nothing runs that would not anyway.
+
+#define PROFILER_MAX_SYSTEMS 16
+
+// Log-linear buckets in the style of HdrHistogram: exact below 64 ns, then 32
+// sub-buckets per power of two, so any recorded value is within ~3% of its
+// bucket. Recording is two atomic adds and safe from any thread.
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_MAX_SHIFT 36
+#define HISTOGRAM_BUCKETS ((2 << HISTOGRAM_SUB_BITS) + HISTOGRAM_MAX_SHIFT * (1 << HISTOGRAM_SUB_BITS))
+
+typedef struct {
+  volatile uint64_t sum;
+  volatile uint64_t max;
+  volatile uint64_t buckets[HISTOGRAM_BUCKETS];
+} LatencyHistogram;
+
+void histogram_record(LatencyHistogram *histogram, uint64_t value);
+uint64_t histogram_count(const LatencyHistogram *histogram);
+// Smallest bucket value with at least `quantile` of the samples at or below it
+uint64_t histogram_quantile(const LatencyHistogram *histogram, double quantile);
+
+bool profiler_enabled();
+system_func profiler_wrap(size_t index, const char *name, system_func fn);
+// Call once per frame with FrameConstants.delta to track frame jitter
+void profiler_frame(float delta);
+// Logs a summary per system and for the frame deltas, then clears them
+void profiler_report();
+
+// TRACE
+
+// With FIASCO_TRACE=<path>, systems (through the same shims), command
+// flushes, texture loads, registration and query_par_for_each callbacks are
+// recorded as spans in per-thread rings. `trace_write` saves them as Chrome
+// Trace Event JSON, which chrome://tracing and Perfetto open.
+#define TRACE_EVENTS 65536 // per thread; older spans are overwritten
+
+bool trace_enabled();
+const char* trace_path();
+// Returns a start stamp for trace_end, or 0 when tracing is off
+uint64_t trace_begin();
+// `name` and `category` must outlive the trace, e.g. string literals
+void trace_end(const char *name, const char *category, uint64_t start);
+query_par_for_each_t trace_wrap_par_for_each(query_par_for_each_t fn);
+// Call while no system is running, e.g. from deinit
+bool trace_write(const char *path);
+void trace_free();
+
+// FFI ACCOUNTING
+
+// With FIASCO_FFI unset nothing changes. With FIASCO_FFI=1,
+// `ffi_wrap_engine` swaps every Engine pointer for a wrapper that counts
+// calls and time per function. `ffi_frame` closes a frame and logs totals
+// every FIASCO_FFI_REPORT frames (600 by default, 0 for never). Time spent in
+// query_for_each and query_par_for_each includes their callbacks.
+typedef struct {
+  const char *name;
+  uint64_t calls;
+  double ns;
+} FfiStat;
+
+bool ffi_enabled();
+void ffi_wrap_engine(Engine *engine);
+// Call once per frame while no other system is running
+void ffi_frame();
+// Functions called during the last closed frame, busiest first
+size_t ffi_last_frame(FfiStat *out, size_t cap);
+// Every call since the engine was wrapped; `frames` gets the closed frames
+size_t ffi_totals(FfiStat *out, size_t cap, uint64_t *frames);
+void ffi_report();
+
+#endif
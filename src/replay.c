@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <replay.h>
+
+#define REPLAY_HEADER 24
+#define REPLAY_HAS_DELTA 0x01
+
+typedef struct {
+  ReplayMode mode;
+  FILE *file; // recording
+  uint8_t *data; // playback, the whole file
+  size_t len;
+  size_t pos;
+  uint8_t last[REPLAY_BLOCK]; // the previous frame's input
+  uint32_t delta_bits;
+  bool has_delta;
+  uint64_t frames;
+} Replay;
+
+Replay replay;
+
+static void put_u32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t *in) {
+  return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+bool replay_record(const char *path, uint64_t seed) {
+  replay_stop();
+  replay.frames = 0;
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) return false;
+
+  uint8_t header[REPLAY_HEADER] = {0};
+  put_u32(header, REPLAY_MAGIC);
+  put_u32(header + 4, REPLAY_FORMAT);
+  put_u32(header + 8, REPLAY_BLOCK);
+  put_u32(header + 16, (uint32_t)seed);
+  put_u32(header + 20, (uint32_t)(seed >> 32));
+  if (fwrite(header, 1, REPLAY_HEADER, file) != REPLAY_HEADER) {
+    fclose(file);
+    return false;
+  }
+
+  replay.mode = ReplayRecord;
+  replay.file = file;
+  return true;
+}
+
+bool replay_play(const char *path, uint64_t *seed) {
+  replay_stop();
+  replay.frames = 0;
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return false;
+
+  fseek(file, 0, SEEK_END);
+  long len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = len >= REPLAY_HEADER ? (uint8_t*)malloc((size_t)len) : NULL;
+  bool ok = data != NULL && fread(data, 1, (size_t)len, file) == (size_t)len;
+  fclose(file);
+
+  // a recording of a different input layout can't be fed back byte for byte
+  if (!ok || get_u32(data) != REPLAY_MAGIC || get_u32(data + 4) > REPLAY_FORMAT ||
+      get_u32(data + 8) != REPLAY_BLOCK) {
+    free(data);
+    return false;
+  }
+
+  *seed = (uint64_t)get_u32(data + 16) | (uint64_t)get_u32(data + 20) << 32;
+  replay.mode = ReplayPlay;
+  replay.data = data;
+  replay.len = (size_t)len;
+  replay.pos = REPLAY_HEADER;
+  return true;
+}
+
+static void record_frame(const uint8_t *input, float delta) {
+  // flags, delta, count and at most one pair per byte
+  uint8_t out[6 + 2 * REPLAY_BLOCK];
+  size_t used = 1;
+
+  uint32_t bits;
+  memcpy(&bits, &delta, sizeof(bits));
+  out[0] = 0;
+  if (!replay.has_delta || bits != replay.delta_bits) {
+    out[0] |= REPLAY_HAS_DELTA;
+    put_u32(out + used, bits);
+    used += 4;
+    replay.delta_bits = bits;
+    replay.has_delta = true;
+  }
+
+  uint8_t *count = &out[used++];
+  *count = 0;
+  for (size_t i = 0; i < REPLAY_BLOCK; i++) {
+    if (input[i] == replay.last[i]) continue;
+    out[used++] = (uint8_t)i;
+    out[used++] = input[i];
+    (*count)++;
+  }
+  memcpy(replay.last, input, REPLAY_BLOCK);
+
+  if (fwrite(out, 1, used, replay.file) != used) {
+    log_error("Input recording failed after %llu frames", (unsigned long long)replay.frames);
+    replay_stop();
+    return;
+  }
+  replay.frames++;
+}
+
+// False at the end of the recording, or at a torn last frame
+static bool play_frame(uint8_t *input, float *delta) {
+  const uint8_t *at = replay.data + replay.pos;
+  size_t left = replay.len - replay.pos;
+  if (left < 2) return false;
+
+  size_t used = 1;
+  if (at[0] & REPLAY_HAS_DELTA) {
+    if (left < 6) return false;
+    replay.delta_bits = get_u32(at + 1);
+    replay.has_delta = true;
+    used += 4;
+  }
+  size_t count = at[used++];
+  if (left < used + 2 * count) return false;
+
+  for (size_t i = 0; i < count; i++, used += 2) {
+    if (at[used] >= REPLAY_BLOCK) return false;
+    replay.last[at[used]] = at[used + 1];
+  }
+  replay.pos += used;
+  replay.frames++;
+
+  memcpy(input, replay.last, REPLAY_BLOCK);
+  if (replay.has_delta) memcpy(delta, &replay.delta_bits, sizeof(float));
+  return true;
+}
+
+ReplayMode replay_frame(uint8_t *input, float *delta) {
+  if (replay.mode == ReplayRecord) {
+    record_frame(input, *delta);
+  } else if (replay.mode == ReplayPlay && !play_frame(input, delta)) {
+    log_info("Input replay finished after %llu frames", (unsigned long long)replay.frames);
+    replay_stop();
+  }
+  return replay.mode;
+}
+
+void replay_stop() {
+  if (replay.mode == ReplayRecord) {
+    log_info("Recorded %llu frames of input", (unsigned long long)replay.frames);
+  }
+  if (replay.file != NULL) fclose(replay.file);
+  free(replay.data);
+  // frames stays readable after the end
+  uint64_t frames = replay.frames;
+  memset(&replay, 0, sizeof(Replay));
+  replay.frames = frames;
+}
+
+uint64_t replay_frames() {
+  return replay.frames;
+}
@@ -0,0 +1,38 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+
+// Input record/replay. Recording appends each frame's raw input block and
+// FrameConstants.delta to a little-endian stream after a header holding the
+// RNG seed. Replaying feeds them back in place of live input, so a session
+// runs the same on every build. A frame is a flags byte, the delta's bits if
+// they changed, a count of changed input bytes and {offset, value} pairs for
+// them, so an idle frame takes 2 bytes.
+
+#define REPLAY_MAGIC 0x4c505246u // "FRPL"
+#define REPLAY_FORMAT 1
+// Every byte key(), mouse() and wheel() decode
+#define REPLAY_BLOCK (MOUSE_OFFSET + 3)
+
+typedef enum {
+  ReplayOff,
+  ReplayRecord,
+  ReplayPlay
+} ReplayMode;
+
+bool replay_record(const char *path, uint64_t seed);
+// Reads the whole recording up front and returns the seed it was made with
+bool replay_play(const char *path, uint64_t *seed);
+// Once per frame, before anything reads input: records the engine's input
+// and delta, or overwrites them with the next recorded frame. Playback ends
+// at the end of the recording and live input takes over again.
+ReplayMode replay_frame(uint8_t *input, float *delta);
+// Flushes a recording and frees a playback
+void replay_stop();
+uint64_t replay_frames();
+
+#endif
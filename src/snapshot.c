@@ -0,0 +1,423 @@
+#include <stdlib.h>
+#include <string.h>
+#include <snapshot.h>
+#include <fiasco_simd.h>
+
+#ifdef _WIN32
+  #include <windows.h> // For CreateFileMapping
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+// CRC32C
+
+// Slicing-by-8 over the Castagnoli polynomial, tables built on first use
+uint32_t crc32c_table[8][256];
+bool crc32c_ready = false;
+
+void crc32c_init() {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78u : crc >> 1;
+    crc32c_table[0][i] = crc;
+  }
+  for (uint32_t i = 0; i < 256; i++) {
+    for (int t = 1; t < 8; t++) {
+      uint32_t prev = crc32c_table[t - 1][i];
+      crc32c_table[t][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
+    }
+  }
+  crc32c_ready = true;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define TARGET_SSE42 __attribute__((target("sse4.2")))
+#else
+  #define TARGET_SSE42
+#endif
+
+// The crc32 instruction computes exactly this polynomial, 8 bytes at a time
+TARGET_SSE42 static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *p, size_t len) {
+  uint64_t crc64 = crc;
+  for (; len >= 8; p += 8, len -= 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = (uint32_t)crc64;
+  while (len-- > 0) crc = _mm_crc32_u8(crc, *p++);
+  return crc;
+}
+
+#endif
+
+// Chains: crc32c(crc32c(0, a), b) == crc32c(0, a ++ b)
+uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t*)data;
+  crc = ~crc;
+
+#if defined(__x86_64__) || defined(_M_X64)
+  // every AVX2 part has SSE4.2
+  if (simd_level() == SimdAvx2) return ~crc32c_sse42(crc, p, len);
+#endif
+
+  if (!crc32c_ready) crc32c_init();
+  for (; len >= 8; p += 8, len -= 8) {
+    uint32_t lo = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    lo ^= crc;
+    crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff] ^
+          crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24] ^
+          crc32c_table[3][p[4]] ^ crc32c_table[2][p[5]] ^ crc32c_table[1][p[6]] ^ crc32c_table[0][p[7]];
+  }
+  while (len-- > 0) crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+  return ~crc;
+}
+
+static inline void encode_u32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static inline uint32_t decode_u32(const uint8_t *in) {
+  return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+// WRITER
+
+static void writer_flush(SnapshotWriter *w) {
+  for (size_t done = 0; done < w->used && !w->failed; ) {
+    size_t n = w->write(w->writer, w->block + done, w->used - done);
+    if (n == 0) w->failed = true;
+    done += n;
+  }
+  w->used = 0;
+}
+
+// Appends to the block; anything a block or larger goes straight to `write`
+static void writer_put(SnapshotWriter *w, const void *data, size_t len) {
+  if (w->failed) return;
+  w->bytes += len;
+
+  if (len >= SNAPSHOT_BLOCK) {
+    writer_flush(w);
+    for (size_t done = 0; done < len && !w->failed; ) {
+      size_t n = w->write(w->writer, (uint8_t*)data + done, len - done);
+      if (n == 0) w->failed = true;
+      done += n;
+    }
+    return;
+  }
+
+  if (w->used + len > SNAPSHOT_BLOCK) writer_flush(w);
+  memcpy(w->block + w->used, data, len);
+  w->used += len;
+}
+
+bool snapshot_write_open(SnapshotWriter *w, void *writer, write_t write) {
+  memset(w, 0, sizeof(SnapshotWriter));
+  w->writer = writer;
+  w->write = write;
+  w->block = (uint8_t*)malloc(SNAPSHOT_BLOCK);
+  if (w->block == NULL) w->failed = true;
+  return !w->failed;
+}
+
+bool snapshot_write_begin(SnapshotWriter *w, void *writer, write_t write) {
+  if (!snapshot_write_open(w, writer, write)) return false;
+
+  uint8_t header[8];
+  encode_u32(header, SNAPSHOT_MAGIC);
+  encode_u32(header + 4, SNAPSHOT_FORMAT);
+  writer_put(w, header, sizeof(header));
+  return !w->failed;
+}
+
+void snapshot_write_section(SnapshotWriter *w, uint32_t tag, uint16_t version, uint64_t length) {
+  if (w->section_left != 0) w->failed = true;
+
+  uint8_t header[16];
+  encode_u32(header, tag);
+  encode_u32(header + 4, version);
+  encode_u32(header + 8, (uint32_t)length);
+  encode_u32(header + 12, (uint32_t)(length >> 32));
+  writer_put(w, header, sizeof(header));
+
+  w->section_left = length;
+  w->crc = 0;
+}
+
+void snapshot_write_bytes(SnapshotWriter *w, const void *data, size_t len) {
+  if (len > w->section_left) {
+    w->failed = true;
+    return;
+  }
+  w->section_left -= len;
+  w->crc = crc32c(w->crc, data, len);
+  writer_put(w, data, len);
+}
+
+void snapshot_write_u32(SnapshotWriter *w, uint32_t value) {
+  uint8_t bytes[4];
+  encode_u32(bytes, value);
+  snapshot_write_bytes(w, bytes, sizeof(bytes));
+}
+
+void snapshot_write_f32(SnapshotWriter *w, float value) {
+  snapshot_write_f32s(w, &value, 1);
+}
+
+// Little-endian hosts write the array as it is; others swap a chunk at a time
+void snapshot_write_f32s(SnapshotWriter *w, const float *values, size_t len) {
+  if (snapshot_little_endian()) {
+    snapshot_write_bytes(w, values, len * sizeof(float));
+    return;
+  }
+
+  uint8_t chunk[4096];
+  while (len > 0) {
+    size_t n = len < sizeof(chunk) / 4 ? len : sizeof(chunk) / 4;
+    for (size_t i = 0; i < n; i++) {
+      uint32_t bits;
+      memcpy(&bits, &values[i], sizeof(bits));
+      encode_u32(chunk + 4 * i, bits);
+    }
+    snapshot_write_bytes(w, chunk, n * 4);
+    values += n;
+    len -= n;
+  }
+}
+
+void snapshot_write_section_end(SnapshotWriter *w) {
+  if (w->section_left != 0) w->failed = true;
+  uint8_t bytes[4];
+  encode_u32(bytes, w->crc);
+  writer_put(w, bytes, sizeof(bytes));
+}
+
+bool snapshot_write_close(SnapshotWriter *w) {
+  if (w->section_left != 0) w->failed = true;
+  writer_flush(w);
+  free(w->block);
+  w->block = NULL;
+  return !w->failed;
+}
+
+bool snapshot_write_end(SnapshotWriter *w) {
+  snapshot_write_section(w, SNAPSHOT_END, 1, 0);
+  snapshot_write_section_end(w);
+  return snapshot_write_close(w);
+}
+
+// READER
+
+// Reads blocks through `read`; anything a block or larger skips the copy
+static bool reader_get(SnapshotReader *r, void *out, size_t len) {
+  uint8_t *dst = (uint8_t*)out;
+  while (len > 0 && !r->failed) {
+    if (r->pos == r->len) {
+      if (len >= SNAPSHOT_BLOCK) {
+        size_t n = r->read(r->reader, dst, len);
+        if (n == 0) r->failed = true;
+        dst += n;
+        len -= n;
+        r->bytes += n;
+        continue;
+      }
+      r->pos = 0;
+      r->len = r->read(r->reader, r->block, SNAPSHOT_BLOCK);
+      if (r->len == 0) {
+        r->failed = true;
+        break;
+      }
+    }
+
+    size_t n = r->len - r->pos < len ? r->len - r->pos : len;
+    memcpy(dst, r->block + r->pos, n);
+    r->pos += n;
+    r->bytes += n;
+    dst += n;
+    len -= n;
+  }
+  return !r->failed;
+}
+
+bool snapshot_read_begin(SnapshotReader *r, void *reader, read_t read) {
+  memset(r, 0, sizeof(SnapshotReader));
+  r->reader = reader;
+  r->read = read;
+  r->block = (uint8_t*)malloc(SNAPSHOT_BLOCK);
+  if (r->block == NULL) {
+    r->failed = true;
+    return false;
+  }
+
+  uint8_t header[8];
+  if (!reader_get(r, header, sizeof(header))) return false;
+  if (decode_u32(header) != SNAPSHOT_MAGIC) {
+    log_error("snapshot: bad magic %08x", decode_u32(header));
+    r->failed = true;
+  } else if (decode_u32(header + 4) > SNAPSHOT_FORMAT) {
+    log_error("snapshot: format %u is newer than %u", decode_u32(header + 4), SNAPSHOT_FORMAT);
+    r->failed = true;
+  }
+  return !r->failed;
+}
+
+bool snapshot_read_section(SnapshotReader *r, uint32_t *tag, uint16_t *version, uint64_t *length) {
+  uint8_t header[16];
+  uint64_t before = r->bytes;
+  if (r->section_left != 0 || !reader_get(r, header, sizeof(header))) {
+    r->eof = r->bytes == before;
+    r->failed = true;
+    return false;
+  }
+
+  *tag = decode_u32(header);
+  *version = (uint16_t)decode_u32(header + 4);
+  *length = decode_u32(header + 8) | (uint64_t)decode_u32(header + 12) << 32;
+  r->section_left = *length;
+  r->crc = 0;
+
+  if (*tag == SNAPSHOT_END) {
+    snapshot_read_section_end(r);
+    return false;
+  }
+  return !r->failed;
+}
+
+bool snapshot_read_bytes(SnapshotReader *r, void *out, size_t len) {
+  if (len > r->section_left) {
+    r->failed = true;
+    return false;
+  }
+  if (!reader_get(r, out, len)) return false;
+  r->section_left -= len;
+  r->crc = crc32c(r->crc, out, len);
+  return true;
+}
+
+bool snapshot_read_u32(SnapshotReader *r, uint32_t *value) {
+  uint8_t bytes[4];
+  if (!snapshot_read_bytes(r, bytes, sizeof(bytes))) return false;
+  *value = decode_u32(bytes);
+  return true;
+}
+
+bool snapshot_read_f32(SnapshotReader *r, float *value) {
+  return snapshot_read_f32s(r, value, 1);
+}
+
+bool snapshot_read_f32s(SnapshotReader *r, float *values, size_t len) {
+  if (!snapshot_read_bytes(r, values, len * sizeof(float))) return false;
+  if (!snapshot_little_endian()) {
+    for (size_t i = 0; i < len; i++) {
+      uint32_t bits = decode_u32((const uint8_t*)&values[i]);
+      memcpy(&values[i], &bits, sizeof(bits));
+    }
+  }
+  return true;
+}
+
+bool snapshot_read_section_end(SnapshotReader *r) {
+  uint8_t scratch[4096];
+  while (r->section_left > 0 && !r->failed) {
+    size_t n = r->section_left < sizeof(scratch) ? (size_t)r->section_left : sizeof(scratch);
+    snapshot_read_bytes(r, scratch, n);
+  }
+
+  uint8_t bytes[4];
+  if (!reader_get(r, bytes, sizeof(bytes))) return false;
+  if (decode_u32(bytes) != r->crc) {
+    log_error("snapshot: section checksum mismatch");
+    r->failed = true;
+  }
+  return !r->failed;
+}
+
+void snapshot_read_end(SnapshotReader *r) {
+  free(r->block);
+  r->block = NULL;
+}
+
+// MAPPING
+
+bool snapshot_map(SnapshotMap *map, const char *path) {
+  memset(map, 0, sizeof(SnapshotMap));
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER size;
+  HANDLE mapping = NULL;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  }
+  CloseHandle(file);
+  if (mapping == NULL) return false;
+  map->data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (map->data == NULL) {
+    CloseHandle(mapping);
+    return false;
+  }
+  map->mapping = mapping;
+  map->len = (size_t)size.QuadPart;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  map->data = (const uint8_t*)data;
+  map->len = (size_t)st.st_size;
+#endif
+
+  if (map->len < 8 || decode_u32(map->data) != SNAPSHOT_MAGIC || decode_u32(map->data + 4) > SNAPSHOT_FORMAT) {
+    snapshot_unmap(map);
+    return false;
+  }
+  return true;
+}
+
+// Walks the section headers only; the one payload returned is crc checked
+const uint8_t* snapshot_map_section(const SnapshotMap *map, uint32_t tag, uint16_t *version, uint64_t *length) {
+  size_t pos = 8;
+  while (pos + 16 <= map->len) {
+    const uint8_t *header = map->data + pos;
+    uint32_t found = decode_u32(header);
+    uint64_t len = decode_u32(header + 8) | (uint64_t)decode_u32(header + 12) << 32;
+    if (found == SNAPSHOT_END || len > map->len - pos - 16 || map->len - pos - 16 - len < 4) return NULL;
+
+    const uint8_t *payload = header + 16;
+    if (found == tag) {
+      if (crc32c(0, payload, (size_t)len) != decode_u32(payload + len)) {
+        log_error("snapshot: section checksum mismatch");
+        return NULL;
+      }
+      *version = (uint16_t)decode_u32(header + 4);
+      *length = len;
+      return payload;
+    }
+    pos += 16 + (size_t)len + 4;
+  }
+  return NULL;
+}
+
+void snapshot_unmap(SnapshotMap *map) {
+  if (map->data != NULL) {
+#ifdef _WIN32
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+#else
+    munmap((void*)map->data, map->len);
+#endif
+  }
+  memset(map, 0, sizeof(SnapshotMap));
+}
@@ -0,0 +1,92 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+
+// Versioned little-endian snapshot stream. A header (magic, format) is
+// followed by sections, each {tag, version, length} + payload + crc32c of the
+// payload, and an END section. Sections only grow by appending fields, so a
+// reader skips unknown sections and the unknown tail of newer ones. Bytes go
+// through write_t/read_t in SNAPSHOT_BLOCK sized calls.
+
+#define SNAPSHOT_MAGIC 0x504e5346u // "FSNP"
+#define SNAPSHOT_FORMAT 1
+#define SNAPSHOT_BLOCK (1 << 20)
+#define SNAPSHOT_TAG(a, b, c, d) ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+#define SNAPSHOT_END SNAPSHOT_TAG('E', 'N', 'D', ' ')
+
+typedef struct {
+  void *writer;
+  write_t write;
+  uint8_t *block;
+  size_t used;
+  uint64_t section_left; // payload bytes the open section still expects
+  uint32_t crc;
+  uint64_t bytes;
+  bool failed;
+} SnapshotWriter;
+
+typedef struct {
+  void *reader;
+  read_t read;
+  uint8_t *block;
+  size_t pos;
+  size_t len;
+  uint64_t section_left;
+  uint32_t crc;
+  uint64_t bytes;
+  bool failed;
+  bool eof; // the stream ended cleanly between sections
+} SnapshotReader;
+
+// A snapshot file mapped read-only, for reading sections in place
+typedef struct {
+  const uint8_t *data;
+  size_t len;
+  void *mapping; // the file mapping handle on Windows
+} SnapshotMap;
+
+static inline bool snapshot_little_endian() {
+  const uint16_t one = 1;
+  return *(const uint8_t*)&one == 1;
+}
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+bool snapshot_write_begin(SnapshotWriter *w, void *writer, write_t write);
+// Like begin without the header, to append sections to an existing stream
+bool snapshot_write_open(SnapshotWriter *w, void *writer, write_t write);
+// `length` is the exact payload size that follows
+void snapshot_write_section(SnapshotWriter *w, uint32_t tag, uint16_t version, uint64_t length);
+void snapshot_write_bytes(SnapshotWriter *w, const void *data, size_t len);
+void snapshot_write_u32(SnapshotWriter *w, uint32_t value);
+void snapshot_write_f32(SnapshotWriter *w, float value);
+void snapshot_write_f32s(SnapshotWriter *w, const float *values, size_t len);
+void snapshot_write_section_end(SnapshotWriter *w);
+// Writes the END section and flushes; false if any step failed
+bool snapshot_write_end(SnapshotWriter *w);
+// Flushes without an END section, leaving the stream open for appending
+bool snapshot_write_close(SnapshotWriter *w);
+
+bool snapshot_read_begin(SnapshotReader *r, void *reader, read_t read);
+// False at the END section or on error; check `failed` to tell them apart.
+// A stream without END that stops between sections fails with `eof` set.
+bool snapshot_read_section(SnapshotReader *r, uint32_t *tag, uint16_t *version, uint64_t *length);
+bool snapshot_read_bytes(SnapshotReader *r, void *out, size_t len);
+bool snapshot_read_u32(SnapshotReader *r, uint32_t *value);
+bool snapshot_read_f32(SnapshotReader *r, float *value);
+bool snapshot_read_f32s(SnapshotReader *r, float *values, size_t len);
+// Skips whatever the section has left and checks its crc
+bool snapshot_read_section_end(SnapshotReader *r);
+void snapshot_read_end(SnapshotReader *r);
+
+// False if the file is missing, not a snapshot or of a newer format
+bool snapshot_map(SnapshotMap *map, const char *path);
+// Payload of the first `tag` section with a matching crc, or NULL
+const uint8_t* snapshot_map_section(const SnapshotMap *map, uint32_t tag, uint16_t *version, uint64_t *length);
+void snapshot_unmap(SnapshotMap *map);
+
+#endif
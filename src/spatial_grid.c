@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <spatial_grid.h>
+
+#define GRID_DEFAULT_CELL 60.0f
+#define GRID_MIN_BUCKETS 64
+
+// Rows hash to a random base and cells in a row take consecutive buckets, so
+// a cell's row neighbours usually sit beside it in the entry array. A bounce
+// still looks up each of the nine buckets around its cell.
+size_t grid_bucket(const SpatialGrid *grid, int32_t cx, int32_t cy) {
+  uint32_t row = (uint32_t)cy * 2654435761u;
+  return (row + (uint32_t)cx) & grid->mask;
+}
+
+void grid_cell(const SpatialGrid *grid, float x, float y, int32_t *cx, int32_t *cy) {
+  *cx = (int32_t)floorf(x / grid->cell_size);
+  *cy = (int32_t)floorf(y / grid->cell_size);
+}
+
+// Cells are two of last frame's largest radius wide, so any overlapping pair
+// sits in neighbouring cells. Roughly one bucket per entry keeps chains short.
+bool spatial_grid_begin(SpatialGrid *grid, size_t len) {
+  float max_radius;
+  uint32_t bits = grid->max_radius_bits;
+  memcpy(&max_radius, &bits, sizeof(max_radius));
+  grid->cell_size = max_radius > 0 ? 2 * max_radius : GRID_DEFAULT_CELL;
+
+  size_t buckets = GRID_MIN_BUCKETS;
+  while (buckets < len) buckets *= 2;
+
+  if (buckets > grid->bucket_cap) {
+    void *counts = realloc((void*)grid->counts, buckets * sizeof(uint32_t));
+    if (counts == NULL) return false;
+    grid->counts = (volatile uint32_t*)counts;
+
+    uint32_t *starts = (uint32_t*)realloc(grid->starts, (buckets + 1) * sizeof(uint32_t));
+    if (starts == NULL) return false;
+    grid->starts = starts;
+    grid->bucket_cap = buckets;
+  }
+
+  if (len > grid->entry_cap) {
+    GridEntry *entries = (GridEntry*)realloc(grid->entries, len * sizeof(GridEntry));
+    if (entries == NULL) return false;
+    grid->entries = entries;
+    grid->entry_cap = len;
+  }
+
+  grid->len = len;
+  grid->mask = buckets - 1;
+  memset((void*)grid->counts, 0, buckets * sizeof(uint32_t));
+  return true;
+}
+
+void spatial_grid_count(SpatialGrid *grid, float x, float y) {
+  int32_t cx, cy;
+  grid_cell(grid, x, y, &cx, &cy);
+  atomic_add_u32(&grid->counts[grid_bucket(grid, cx, cy)], 1);
+}
+
+// Turns counts into start offsets and resets them as insert cursors
+void spatial_grid_prefix(SpatialGrid *grid) {
+  uint32_t total = 0;
+  for (size_t b = 0; b <= grid->mask; b++) {
+    grid->starts[b] = total;
+    total += grid->counts[b];
+    grid->counts[b] = grid->starts[b];
+  }
+  grid->starts[grid->mask + 1] = total;
+}
+
+void spatial_grid_insert(SpatialGrid *grid, GridEntry entry) {
+  int32_t cx, cy;
+  grid_cell(grid, entry.x, entry.y, &cx, &cy);
+  size_t bucket = grid_bucket(grid, cx, cy);
+  uint32_t slot = atomic_add_u32(&grid->counts[bucket], 1) - 1;
+  if (slot < grid->starts[bucket + 1]) grid->entries[slot] = entry;
+
+  // positive floats order like their bits; only the rare new maximum writes
+  uint32_t bits;
+  memcpy(&bits, &entry.radius, sizeof(bits));
+  uint32_t seen = grid->max_radius_bits;
+  while (bits > seen && !atomic_cas_u32(&grid->max_radius_bits, seen, bits)) {
+    seen = grid->max_radius_bits;
+  }
+}
+
+// Orders entries by position, then radius
+static bool grid_entry_before(const GridEntry *a, const GridEntry *b) {
+  if (a->x != b->x) return a->x < b->x;
+  if (a->y != b->y) return a->y < b->y;
+  return a->radius < b->radius;
+}
+
+// Inserts from several workers land in a bucket in whichever order their
+// cursors were taken, and a bounce reflects off neighbours one at a time, so
+// each bucket is put in a fixed order first. Entries that tie are the same
+// obstacle to a bounce, so their order does not matter. Buckets hold about one
+// entry, so an insertion sort is enough.
+void spatial_grid_sort(SpatialGrid *grid) {
+  for (size_t b = 0; b <= grid->mask; b++) {
+    for (uint32_t i = grid->starts[b] + 1; i < grid->starts[b + 1]; i++) {
+      GridEntry entry = grid->entries[i];
+      uint32_t j = i;
+      for (; j > grid->starts[b] && grid_entry_before(&entry, &grid->entries[j - 1]); j--) {
+        grid->entries[j] = grid->entries[j - 1];
+      }
+      grid->entries[j] = entry;
+    }
+  }
+}
+
+// Reflects `self`'s heading off every neighbour it overlaps and is moving
+// towards. Only the entry's own heading is written, so every entry can be
+// bounced from its own worker. An entry skips itself because its distance is
+// zero. Returns the number of bounces.
+size_t spatial_grid_bounce(const SpatialGrid *grid, GridEntry self) {
+  Vec2 direction = *self.direction;
+  int32_t cx, cy;
+  grid_cell(grid, self.x, self.y, &cx, &cy);
+
+  size_t hits = 0;
+  for (int32_t dy = -1; dy <= 1; dy++) {
+    for (int32_t dx = -1; dx <= 1; dx++) {
+      size_t bucket = grid_bucket(grid, cx + dx, cy + dy);
+
+      for (uint32_t i = grid->starts[bucket]; i < grid->starts[bucket + 1]; i++) {
+        const GridEntry *other = &grid->entries[i];
+        float nx = other->x - self.x;
+        float ny = other->y - self.y;
+        float reach = self.radius + other->radius;
+        float dist2 = nx * nx + ny * ny;
+        if (dist2 >= reach * reach || dist2 == 0) continue;
+
+        float approach = direction.x * nx + direction.y * ny;
+        if (approach <= 0) continue;
+
+        float scale = 2 * approach / dist2;
+        direction.x -= scale * nx;
+        direction.y -= scale * ny;
+        hits++;
+      }
+    }
+  }
+
+  if (hits > 0) *self.direction = direction;
+  return hits;
+}
+
+void spatial_grid_free(SpatialGrid *grid) {
+  free((void*)grid->counts);
+  free(grid->starts);
+  free(grid->entries);
+  memset(grid, 0, sizeof(SpatialGrid));
+}
@@ -0,0 +1,42 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+
+// `direction` points back at the owner's heading, the only thing a bounce writes
+typedef struct {
+  float x;
+  float y;
+  float radius;
+  Vec2 *direction;
+} GridEntry;
+
+// Uniform grid hashed into a power-of-two bucket table and rebuilt every frame
+// with a counting sort: begin, count every entry, prefix, insert every entry.
+// Sort then fixes the order inside each bucket, and each entry is bounced
+// against the grid on its own. Count, insert and bounce are safe to call from
+// worker threads; prefix and sort run on one.
+typedef struct {
+  float cell_size;
+  volatile uint32_t max_radius_bits; // largest radius inserted, sizes the next rebuild
+  size_t len;
+  size_t mask;
+  size_t bucket_cap;
+  size_t entry_cap;
+  volatile uint32_t *counts; // entries per bucket, then insert cursors
+  uint32_t *starts;          // bucket_cap + 1 offsets into entries
+  GridEntry *entries;
+} SpatialGrid;
+
+bool spatial_grid_begin(SpatialGrid *grid, size_t len);
+void spatial_grid_count(SpatialGrid *grid, float x, float y);
+void spatial_grid_prefix(SpatialGrid *grid);
+void spatial_grid_insert(SpatialGrid *grid, GridEntry entry);
+void spatial_grid_sort(SpatialGrid *grid);
+size_t spatial_grid_bounce(const SpatialGrid *grid, GridEntry self);
+void spatial_grid_free(SpatialGrid *grid);
+
+#endif
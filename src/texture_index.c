@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <texture_index.h>
+
+#define TEXTURE_INDEX_INITIAL_CAP 64
+#define TEXTURE_INDEX_PATH_MAX 4096
+
+bool file_stamp(const char *path, uint64_t *mtime, uint64_t *size) {
+  struct stat st;
+  if (stat(path, &st) != 0) return false;
+#if defined(__APPLE__)
+  *mtime = (uint64_t)st.st_mtimespec.tv_sec * 1000000000ull + (uint64_t)st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+  *mtime = (uint64_t)st.st_mtime * 1000000000ull;
+#else
+  *mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+#endif
+  *size = (uint64_t)st.st_size;
+  return true;
+}
+
+static size_t slot_for(const TextureIndex *index, const char *path, uint32_t hash) {
+  size_t mask = index->slots_cap - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    uint32_t slot = index->slots[i];
+    if (slot == 0) return i;
+    const TextureIndexRecord *record = &index->records[slot - 1];
+    if (record->hash == hash && strcmp(record->path, path) == 0) return i;
+  }
+}
+
+static bool index_grow(TextureIndex *index) {
+  size_t cap = index->cap ? index->cap * 2 : TEXTURE_INDEX_INITIAL_CAP;
+  TextureIndexRecord *records = (TextureIndexRecord*)realloc(index->records, cap * sizeof(TextureIndexRecord));
+  if (records == NULL) return false;
+  index->records = records;
+
+  uint32_t *slots = (uint32_t*)calloc(cap * 2, sizeof(uint32_t));
+  if (slots == NULL) return false;
+  free(index->slots);
+  index->slots = slots;
+  index->slots_cap = cap * 2;
+  index->cap = cap;
+  for (size_t r = 0; r < index->len; r++) {
+    index->slots[slot_for(index, index->records[r].path, index->records[r].hash)] = (uint32_t)(r + 1);
+  }
+  return true;
+}
+
+TextureIndexRecord* texture_index_find(TextureIndex *index, const char *path, uint64_t mtime, uint64_t size) {
+  if (index->len == 0) return NULL;
+  uint32_t slot = index->slots[slot_for(index, path, hash_string(path))];
+  if (slot == 0) return NULL;
+  TextureIndexRecord *record = &index->records[slot - 1];
+  return record->mtime == mtime && record->size == size ? record : NULL;
+}
+
+TextureIndexRecord* texture_index_put(TextureIndex *index, const char *path, uint64_t mtime, uint64_t size) {
+  if (index->len == index->cap && !index_grow(index)) return NULL;
+
+  uint32_t hash = hash_string(path);
+  size_t slot = slot_for(index, path, hash);
+  TextureIndexRecord *record;
+  if (index->slots[slot] != 0) {
+    record = &index->records[index->slots[slot] - 1];
+  } else {
+    char *key = arena_strdup(&index->paths, path);
+    if (key == NULL) return NULL;
+    record = &index->records[index->len];
+    memset(record, 0, sizeof(TextureIndexRecord));
+    record->path = key;
+    record->hash = hash;
+    index->slots[slot] = (uint32_t)(++index->len);
+  }
+
+  if (record->mtime != mtime || record->size != size) {
+    // a changed file has to report its size and format again
+    memset(&record->content, 0, sizeof(TextureHash));
+    record->width = record->height = 0;
+    memset(record->format, 0, sizeof(record->format));
+  }
+  record->mtime = mtime;
+  record->size = size;
+  index->dirty = true;
+  return record;
+}
+
+static uint32_t get_u32(const uint8_t *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static uint64_t get_u64(const uint8_t *data) {
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+bool texture_index_load(TextureIndex *index, const char *path) {
+  texture_index_free(index);
+  SnapshotMap map;
+  if (!snapshot_little_endian() || !snapshot_map(&map, path)) return false;
+
+  uint16_t version;
+  uint64_t head_len, names_len, records_len;
+  const uint8_t *head = snapshot_map_section(&map, TEXTURE_INDEX_TIDX, &version, &head_len);
+  const uint8_t *names = snapshot_map_section(&map, TEXTURE_INDEX_NAME, &version, &names_len);
+  const uint8_t *records = snapshot_map_section(&map, TEXTURE_INDEX_TREC, &version, &records_len);
+  uint32_t count = head != NULL && head_len >= 4 ? get_u32(head) : 0;
+  bool ok = head != NULL && names != NULL && records != NULL && (names_len == 0 || names[names_len - 1] == '\0') &&
+            records_len >= (uint64_t)count * TEXTURE_INDEX_RECORD_BYTES;
+
+  for (uint32_t r = 0; ok && r < count; r++) {
+    const uint8_t *at = records + (size_t)r * TEXTURE_INDEX_RECORD_BYTES;
+    uint32_t offset = get_u32(at);
+    ok = offset < names_len;
+    TextureIndexRecord *record = ok ? texture_index_put(index, (const char*)names + offset, get_u64(at + 4),
+                                                        get_u64(at + 12)) : NULL;
+    ok = record != NULL;
+    if (!ok) break;
+    memcpy(record->content.hash, at + 20, sizeof(record->content.hash));
+    record->width = get_u32(at + 28);
+    record->height = get_u32(at + 32);
+    memcpy(record->format, at + 36, TEXTURE_FORMAT_MAX);
+    record->format[TEXTURE_FORMAT_MAX - 1] = '\0';
+  }
+
+  snapshot_unmap(&map);
+  if (!ok) {
+    log_warn("The texture index %s is damaged, starting a new one", path);
+    texture_index_free(index);
+    return false;
+  }
+  index->dirty = false;
+  return true;
+}
+
+static size_t file_write(void *file, void *buf, size_t len) {
+  return fwrite(buf, 1, len, (FILE*)file);
+}
+
+bool texture_index_save(TextureIndex *index, const char *path) {
+  char tmp[TEXTURE_INDEX_PATH_MAX];
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return false;
+  FILE *file = fopen(tmp, "wb");
+  if (file == NULL) {
+    log_error("Could not open %s", tmp);
+    return false;
+  }
+
+  uint64_t names_len = 0;
+  for (size_t r = 0; r < index->len; r++) names_len += strlen(index->records[r].path) + 1;
+
+  SnapshotWriter w;
+  snapshot_write_begin(&w, file, file_write);
+  snapshot_write_section(&w, TEXTURE_INDEX_TIDX, TEXTURE_INDEX_VERSION, 4);
+  snapshot_write_u32(&w, (uint32_t)index->len);
+  snapshot_write_section_end(&w);
+
+  snapshot_write_section(&w, TEXTURE_INDEX_NAME, TEXTURE_INDEX_VERSION, names_len);
+  for (size_t r = 0; r < index->len; r++) {
+    snapshot_write_bytes(&w, index->records[r].path, strlen(index->records[r].path) + 1);
+  }
+  snapshot_write_section_end(&w);
+
+  uint32_t offset = 0;
+  snapshot_write_section(&w, TEXTURE_INDEX_TREC, TEXTURE_INDEX_VERSION,
+                         (uint64_t)index->len * TEXTURE_INDEX_RECORD_BYTES);
+  for (size_t r = 0; r < index->len; r++) {
+    const TextureIndexRecord *record = &index->records[r];
+    snapshot_write_u32(&w, offset);
+    snapshot_write_u32(&w, (uint32_t)record->mtime);
+    snapshot_write_u32(&w, (uint32_t)(record->mtime >> 32));
+    snapshot_write_u32(&w, (uint32_t)record->size);
+    snapshot_write_u32(&w, (uint32_t)(record->size >> 32));
+    snapshot_write_bytes(&w, record->content.hash, sizeof(record->content.hash));
+    snapshot_write_u32(&w, record->width);
+    snapshot_write_u32(&w, record->height);
+    snapshot_write_bytes(&w, record->format, TEXTURE_FORMAT_MAX);
+    offset += (uint32_t)strlen(record->path) + 1;
+  }
+  snapshot_write_section_end(&w);
+
+  bool ok = snapshot_write_end(&w);
+  ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+  if (ok) remove(path); // rename does not replace on Windows
+#endif
+  if (!ok || rename(tmp, path) != 0) {
+    log_error("Could not write the texture index %s", path);
+    remove(tmp);
+    return false;
+  }
+  index->dirty = false;
+  return true;
+}
+
+// The paths belong to the index's own arena
+void texture_index_free(TextureIndex *index) {
+  free(index->records);
+  free(index->slots);
+  arena_free(&index->paths);
+  memset(index, 0, sizeof(TextureIndex));
+}
@@ -0,0 +1,59 @@
+#ifndef TEXTURE_INDEX_H
+#define TEXTURE_INDEX_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+#include <snapshot.h>
+
+// What the texture cache learned about each file in earlier sessions: its
+// content hash, keyed by path, modification time and size, and the
+// metadata the engine reported once it loaded. A file whose time and size
+// still match is not read or hashed again. Saved as a snapshot stream:
+//   TIDX {record count}
+//   NAME NUL-terminated paths
+//   TREC per record {path offset, mtime, size, hash, width, height, format}
+
+#define TEXTURE_INDEX_TIDX SNAPSHOT_TAG('T', 'I', 'D', 'X')
+#define TEXTURE_INDEX_NAME SNAPSHOT_TAG('N', 'A', 'M', 'E')
+#define TEXTURE_INDEX_TREC SNAPSHOT_TAG('T', 'R', 'E', 'C')
+#define TEXTURE_INDEX_VERSION 1
+#define TEXTURE_INDEX_RECORD_BYTES 44
+#define TEXTURE_FORMAT_MAX 8
+
+typedef struct {
+  const char *path;
+  uint32_t hash; // of the path
+  uint64_t mtime;
+  uint64_t size;
+  TextureHash content; // all zero until hashed
+  uint32_t width; // 0 until the engine has loaded it once
+  uint32_t height;
+  char format[TEXTURE_FORMAT_MAX];
+} TextureIndexRecord;
+
+typedef struct {
+  TextureIndexRecord *records;
+  size_t len;
+  size_t cap;
+  uint32_t *slots; // open-addressed, record index + 1, 0 when empty
+  size_t slots_cap;
+  Arena paths;
+  bool dirty; // changed since it was loaded or saved
+} TextureIndex;
+
+// False when there is no usable index at `path`; `index` is empty then
+bool texture_index_load(TextureIndex *index, const char *path);
+// Written beside `path` and renamed over it
+bool texture_index_save(TextureIndex *index, const char *path);
+// The record for `path` if its time and size still match, otherwise NULL
+TextureIndexRecord* texture_index_find(TextureIndex *index, const char *path, uint64_t mtime, uint64_t size);
+// The record for `path`, added if new, with the given time and size
+TextureIndexRecord* texture_index_put(TextureIndex *index, const char *path, uint64_t mtime, uint64_t size);
+void texture_index_free(TextureIndex *index);
+
+// Modification time and size of a file; false if it cannot be read
+bool file_stamp(const char *path, uint64_t *mtime, uint64_t *size);
+
+#endif
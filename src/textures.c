@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <textures.h>
+#include <atlas.h>
+#include <profiler.h>
+
+#define TEXTURES_INITIAL_CAP 64
+#define TEXTURES_PATH_MAX 4096
+
+static size_t slot_for(const TextureCache *cache, const char *path, uint32_t hash) {
+  size_t mask = cache->slots_cap - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    uint32_t slot = cache->slots[i];
+    if (slot == 0) return i;
+    const TextureEntry *entry = &cache->entries[slot - 1];
+    if (entry->hash == hash && strcmp(entry->path, path) == 0) return i;
+  }
+}
+
+static uint32_t content_key(const TextureHash *content) {
+  uint32_t key;
+  memcpy(&key, content->hash, sizeof(key));
+  return key;
+}
+
+static size_t content_slot_for(const TextureCache *cache, const TextureHash *content) {
+  size_t mask = cache->slots_cap - 1;
+  for (size_t i = content_key(content) & mask; ; i = (i + 1) & mask) {
+    uint32_t slot = cache->contents[i];
+    if (slot == 0) return i;
+    if (memcmp(cache->entries[slot - 1].content.hash, content->hash, sizeof(content->hash)) == 0) return i;
+  }
+}
+
+// Entries, the pending lists and the slot tables grow together, keeping the
+// slots under half full
+static bool textures_grow(TextureCache *cache) {
+  size_t cap = cache->cap ? cache->cap * 2 : TEXTURES_INITIAL_CAP;
+  TextureEntry *entries = (TextureEntry*)realloc(cache->entries, cap * sizeof(TextureEntry));
+  if (entries == NULL) return false;
+  cache->entries = entries;
+  uint32_t *pending = (uint32_t*)realloc(cache->pending, cap * sizeof(uint32_t));
+  if (pending == NULL) return false;
+  cache->pending = pending;
+  TextureId *pending_ids = (TextureId*)realloc(cache->pending_ids, cap * sizeof(TextureId));
+  if (pending_ids == NULL) return false;
+  cache->pending_ids = pending_ids;
+
+  uint32_t *slots = (uint32_t*)calloc(cap * 2, sizeof(uint32_t));
+  uint32_t *contents = (uint32_t*)calloc(cap * 2, sizeof(uint32_t));
+  if (slots == NULL || contents == NULL) {
+    free(slots);
+    free(contents);
+    return false;
+  }
+  free(cache->slots);
+  free(cache->contents);
+  cache->slots = slots;
+  cache->contents = contents;
+  cache->slots_cap = cap * 2;
+  cache->cap = cap;
+  for (size_t e = 0; e < cache->len; e++) {
+    const TextureEntry *entry = &cache->entries[e];
+    cache->slots[slot_for(cache, entry->path, entry->hash)] = (uint32_t)(e + 1);
+    if (entry->hashed && entry->shares == 0) {
+      cache->contents[content_slot_for(cache, &entry->content)] = (uint32_t)(e + 1);
+    }
+  }
+  return true;
+}
+
+void textures_open_index(TextureCache *cache, const char *path) {
+  cache->index_path = path;
+  if (texture_index_load(&cache->index, path)) {
+    log_debug("Texture index %s knows %zu files", path, cache->index.len);
+  }
+}
+
+bool textures_save_index(TextureCache *cache) {
+  if (cache->index_path == NULL || !cache->index.dirty) return true;
+  return texture_index_save(&cache->index, cache->index_path);
+}
+
+static bool read_whole_file(const char *path, uint64_t size, uint8_t **data) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return false;
+  *data = (uint8_t*)malloc(size ? size : 1);
+  bool ok = *data != NULL && fread(*data, 1, size, file) == size;
+  fclose(file);
+  if (!ok) {
+    free(*data);
+    *data = NULL;
+  }
+  return ok;
+}
+
+// From the index while the file's time and size match, otherwise read and
+// hashed by the engine and remembered. False for files it cannot read,
+// which load as before and fail in the engine.
+static bool content_hash(TextureCache *cache, const char *path, TextureHash *content, uint32_t *record_index) {
+  uint64_t mtime, size;
+  if (!file_stamp(path, &mtime, &size) || size > UINT32_MAX) return false;
+
+  static const TextureHash unhashed = {{0}};
+  TextureIndexRecord *record = texture_index_find(&cache->index, path, mtime, size);
+  if (record != NULL && memcmp(&record->content, &unhashed, sizeof(TextureHash)) != 0) {
+    *content = record->content;
+    *record_index = (uint32_t)(record - cache->index.records) + 1;
+    cache->index_hits++;
+    return true;
+  }
+
+  uint8_t *data;
+  if (!read_whole_file(path, size, &data)) return false;
+  *content = cache->engine->texture_asset_manager_generate_hash(data, (uint32_t)size);
+  free(data);
+  cache->hashed++;
+
+  record = texture_index_put(&cache->index, path, mtime, size);
+  *record_index = 0;
+  if (record != NULL) {
+    record->content = *content;
+    *record_index = (uint32_t)(record - cache->index.records) + 1;
+  }
+  return true;
+}
+
+static void entry_init(TextureEntry *entry, const char *key, uint32_t hash, TextureId id, TextureState state) {
+  memset(entry, 0, sizeof(TextureEntry));
+  entry->path = key;
+  entry->hash = hash;
+  entry->id = id;
+  entry->state = state;
+  entry->uv[2] = entry->uv[3] = 1;
+}
+
+bool textures_load(TextureCache *cache, void *manager, const void *event_writer, const char *path, TextureId *id) {
+  if (cache->len == cache->cap && !textures_grow(cache)) return false;
+
+  uint32_t hash = hash_string(path);
+  size_t slot = slot_for(cache, path, hash);
+  if (cache->slots[slot] != 0) {
+    *id = cache->entries[cache->slots[slot] - 1].id;
+    return true;
+  }
+
+  char *key = arena_strdup(cache->arena, path);
+  if (key == NULL) return false;
+
+  TextureHash content;
+  uint32_t record = 0;
+  bool hashed = cache->index_path != NULL && content_hash(cache, path, &content, &record);
+  size_t content_slot = hashed ? content_slot_for(cache, &content) : 0;
+  if (hashed && cache->contents[content_slot] != 0) {
+    // the same image under another path: a lookup instead of a load
+    const TextureEntry *first = &cache->entries[cache->contents[content_slot] - 1];
+    TextureEntry *entry = &cache->entries[cache->len];
+    entry_init(entry, key, hash, first->id, first->state);
+    entry->shares = cache->contents[content_slot];
+    entry->content = content;
+    entry->hashed = true;
+    entry->record = record;
+    entry->width = first->width;
+    entry->height = first->height;
+    memcpy(entry->format, first->format, sizeof(entry->format));
+    cache->slots[slot] = (uint32_t)(++cache->len);
+    cache->duplicates++;
+    *id = entry->id;
+    return true;
+  }
+
+  PendingTexture pending;
+  LoadTextureStatus status = cache->engine->texture_asset_manager_load_texture(manager, event_writer, key, true,
+                                                                              &pending);
+  if (status != LoadPendingTextureSuccess) {
+    log_error("There was an error loading the texture %s. Status %u", path, status);
+    return false;
+  }
+
+  TextureEntry *entry = &cache->entries[cache->len];
+  entry_init(entry, key, hash, pending.id, TexturePending);
+  if (hashed) {
+    entry->content = content;
+    entry->hashed = true;
+    entry->record = record;
+    cache->contents[content_slot] = (uint32_t)(cache->len + 1);
+  }
+  if (record != 0 && cache->index.records[record - 1].width != 0) {
+    // known before the engine has even read the file
+    const TextureIndexRecord *known = &cache->index.records[record - 1];
+    entry->width = known->width;
+    entry->height = known->height;
+    memcpy(entry->format, known->format, sizeof(entry->format));
+  }
+  cache->pending[cache->pending_len] = (uint32_t)cache->len;
+  cache->pending_ids[cache->pending_len++] = pending.id;
+  cache->slots[slot] = (uint32_t)(++cache->len);
+  *id = pending.id;
+  return true;
+}
+
+static bool absolute_path(const char *path) {
+  return path[0] == '/' || path[0] == '\\' || (path[0] != '\0' && path[1] == ':');
+}
+
+// Where `path` sits, "." when it has no directory
+static void parent_dir(char *dir, size_t len, const char *path) {
+  snprintf(dir, len, "%s", path);
+  char *slash = strrchr(dir, '/');
+  char *backslash = strrchr(dir, '\\');
+  if (backslash != NULL && (slash == NULL || backslash > slash)) slash = backslash;
+  if (slash != NULL) *slash = '\0';
+  else snprintf(dir, len, ".");
+}
+
+size_t textures_load_atlas(TextureCache *cache, void *manager, const void *event_writer, const char *path) {
+  Atlas atlas;
+  if (!atlas_load(&atlas, path)) return 0;
+
+  char dir[TEXTURES_PATH_MAX];
+  parent_dir(dir, sizeof(dir), path);
+
+  // sheet entry index + 1 for each sheet, 0 if it could not be requested
+  uint32_t *sheets = (uint32_t*)calloc(atlas.sheets_len + 1, sizeof(uint32_t));
+  for (size_t s = 0; sheets != NULL && s < atlas.sheets_len; s++) {
+    char sheet[TEXTURES_PATH_MAX];
+    TextureId id;
+    if (snprintf(sheet, sizeof(sheet), "%s/%s", dir, atlas.sheets[s]) >= (int)sizeof(sheet)) continue;
+    if (textures_load(cache, manager, event_writer, sheet, &id)) {
+      sheets[s] = cache->slots[slot_for(cache, sheet, hash_string(sheet))];
+    }
+  }
+
+  size_t registered = 0;
+  for (size_t i = 0; sheets != NULL && i < atlas.sprites_len; i++) {
+    const AtlasSprite *sprite = &atlas.sprites[i];
+    char sprite_path[TEXTURES_PATH_MAX];
+    if (sheets[sprite->sheet] == 0 ||
+        snprintf(sprite_path, sizeof(sprite_path), "%s/%s", dir, sprite->name) >= (int)sizeof(sprite_path)) {
+      continue;
+    }
+    if (cache->len == cache->cap && !textures_grow(cache)) break;
+
+    uint32_t hash = hash_string(sprite_path);
+    size_t slot = slot_for(cache, sprite_path, hash);
+    if (cache->slots[slot] != 0) continue;
+    char *key = arena_strdup(cache->arena, sprite_path);
+    if (key == NULL) break;
+
+    const TextureEntry *sheet = &cache->entries[sheets[sprite->sheet] - 1];
+    TextureEntry *entry = &cache->entries[cache->len];
+    entry_init(entry, key, hash, sheet->id, sheet->state);
+    entry->shares = sheets[sprite->sheet];
+    memcpy(entry->uv, sprite->uv, sizeof(entry->uv));
+    entry->width = sprite->w;
+    entry->height = sprite->h;
+    memcpy(entry->format, sheet->format, sizeof(entry->format));
+    cache->slots[slot] = (uint32_t)(++cache->len);
+    cache->sprites++;
+    registered++;
+  }
+
+  if (sheets == NULL) log_error("Out of memory loading the atlas %s", path);
+  log_debug("Registered %zu sprites on %zu sheets from %s", registered, atlas.sheets_len, path);
+  free(sheets);
+  atlas_free(&atlas);
+  return registered;
+}
+
+size_t textures_load_manifest(TextureCache *cache, void *manager, const void *event_writer, const char *manifest) {
+  FILE *file = fopen(manifest, "r");
+  if (file == NULL) {
+    log_error("Could not open the texture manifest %s", manifest);
+    return 0;
+  }
+
+  // entries are relative to the manifest's directory
+  char dir[TEXTURES_PATH_MAX];
+  const char *cwd = absolute_path(manifest) ? NULL : current_dir(cache->arena);
+  snprintf(dir, sizeof(dir), "%s%s%s", cwd != NULL ? cwd : "", cwd != NULL ? "/" : "", manifest);
+  char *slash = strrchr(dir, '/');
+  char *backslash = strrchr(dir, '\\');
+  if (backslash != NULL && (slash == NULL || backslash > slash)) slash = backslash;
+  if (slash != NULL) *slash = '\0';
+
+  uint64_t span = trace_begin();
+  size_t requested = 0;
+  char line[TEXTURES_PATH_MAX];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    size_t len = strcspn(line, "\r\n");
+    line[len] = '\0';
+    if (len == 0 || line[0] == '#') continue;
+
+    char path[TEXTURES_PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", slash != NULL ? dir : ".", line) >= (int)sizeof(path)) {
+      log_warn("Texture path too long in %s: %s", manifest, line);
+      continue;
+    }
+    TextureId id;
+    size_t path_len = strlen(path);
+    if (path_len > 6 && strcmp(path + path_len - 6, ".atlas") == 0) {
+      requested += textures_load_atlas(cache, manager, event_writer, path);
+    } else if (textures_load(cache, manager, event_writer, path, &id)) {
+      requested++;
+    }
+  }
+  fclose(file);
+  trace_end("load_manifest", "texture", span);
+
+  log_debug("Requested %zu textures from %s", requested, manifest);
+  return requested;
+}
+
+// Sprites and duplicates take whatever state the texture they share settled
+// in; duplicates its size and format too
+static void settle_shared(TextureCache *cache) {
+  if (cache->sprites == 0 && cache->duplicates == 0) return;
+  for (size_t e = 0; e < cache->len; e++) {
+    TextureEntry *entry = &cache->entries[e];
+    if (entry->shares == 0) continue;
+    const TextureEntry *shared = &cache->entries[entry->shares - 1];
+    entry->state = shared->state;
+    if (entry->width == 0) {
+      entry->width = shared->width;
+      entry->height = shared->height;
+      memcpy(entry->format, shared->format, sizeof(entry->format));
+    }
+  }
+}
+
+// Asks the engine for a loaded texture's size and format once, for the index
+static void describe(TextureCache *cache, void *manager, TextureEntry *entry) {
+  if (cache->index_path == NULL || entry->width != 0) return;
+  LoadedTexture loaded;
+  if (cache->engine->texture_asset_manager_get_loaded_texture_by_id(manager, entry->id, &loaded) != 0) return;
+  entry->width = loaded.width;
+  entry->height = loaded.height;
+  snprintf(entry->format, sizeof(entry->format), "%s", loaded.format_type != NULL ? loaded.format_type : "");
+  cache->engine->texture_asset_manager_free_loaded_texture(&loaded);
+
+  if (entry->record != 0) {
+    TextureIndexRecord *record = &cache->index.records[entry->record - 1];
+    record->width = entry->width;
+    record->height = entry->height;
+    memcpy(record->format, entry->format, sizeof(record->format));
+    cache->index.dirty = true;
+  }
+}
+
+size_t textures_poll(TextureCache *cache, void *manager) {
+  if (cache->pending_len == 0) return 0;
+
+  // one call settles the common case of everything having finished
+  const Engine *engine = cache->engine;
+  if (engine->texture_asset_manager_are_ids_loaded(manager, cache->pending_ids, (uint32_t)cache->pending_len)) {
+    for (size_t p = 0; p < cache->pending_len; p++) {
+      TextureEntry *entry = &cache->entries[cache->pending[p]];
+      entry->state = TextureReady;
+      describe(cache, manager, entry);
+    }
+    cache->pending_len = 0;
+    settle_shared(cache);
+    return 0;
+  }
+
+  size_t kept = 0;
+  for (size_t p = 0; p < cache->pending_len; p++) {
+    TextureEntry *entry = &cache->entries[cache->pending[p]];
+    TextureType type = engine->texture_asset_manager_get_texture_type_by_id(manager, entry->id);
+    if (type == PendingType) {
+      cache->pending[kept] = cache->pending[p];
+      cache->pending_ids[kept++] = entry->id;
+    } else if (type == FailedType) {
+      entry->state = TextureFailed;
+      cache->failed++;
+      log_warn("Texture %s failed to load", entry->path);
+    } else {
+      entry->state = TextureReady;
+      describe(cache, manager, entry);
+    }
+  }
+  if (kept != cache->pending_len) settle_shared(cache);
+  cache->pending_len = kept;
+  return kept;
+}
+
+const TextureEntry* textures_find(const TextureCache *cache, const char *path) {
+  if (cache->len == 0) return NULL;
+  uint32_t slot = cache->slots[slot_for(cache, path, hash_string(path))];
+  return slot == 0 ? NULL : &cache->entries[slot - 1];
+}
+
+// The paths belong to the cache's arena
+void textures_free(TextureCache *cache) {
+  free(cache->entries);
+  free(cache->slots);
+  free(cache->contents);
+  texture_index_free(&cache->index);
+  free(cache->pending);
+  free(cache->pending_ids);
+  Arena *arena = cache->arena;
+  const Engine *engine = cache->engine;
+  memset(cache, 0, sizeof(TextureCache));
+  cache->arena = arena;
+  cache->engine = engine;
+}
@@ -0,0 +1,88 @@
+#ifndef TEXTURES_H
+#define TEXTURES_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fiasco.h>
+#include <texture_index.h>
+
+// Texture loads through the engine's texture asset manager, keyed by path so
+// each file is requested once. Every load is issued up front and the engine
+// finishes them over later frames; textures_poll asks it about the ones
+// still pending, so startup overlaps all the file reads instead of waiting
+// on each. Paths live in `arena`, the tables on the heap.
+//
+// With an index open, each file is also keyed by a hash of its content, so
+// the same image under another path shares the first one's TextureId
+// instead of loading again. The index remembers those hashes and the
+// engine's width, height and format across sessions.
+
+typedef enum {
+  TexturePending,
+  TextureReady,
+  TextureFailed
+} TextureState;
+
+typedef struct {
+  const char *path;
+  uint32_t hash;
+  TextureId id;
+  TextureState state;
+  // entry index + 1 whose texture this one uses: its atlas sheet or an
+  // earlier file with the same content. 0 when it loaded its own.
+  uint32_t shares;
+  float uv[4]; // u0, v0, u1, v1 within `id`
+  TextureHash content;
+  bool hashed;
+  uint32_t record; // index record + 1, 0 when not in the index
+  uint32_t width; // 0 until known
+  uint32_t height;
+  char format[TEXTURE_FORMAT_MAX];
+} TextureEntry;
+
+typedef struct {
+  TextureEntry *entries;
+  size_t len;
+  size_t cap;
+  uint32_t *slots; // open-addressed, entry index + 1, 0 when empty
+  uint32_t *contents; // the same by content hash, for hashed entries with their own texture
+  size_t slots_cap;
+  uint32_t *pending; // entry indices still loading
+  TextureId *pending_ids; // the same, as the manager wants them
+  size_t pending_len;
+  size_t failed;
+  size_t sprites; // entries that live on an atlas sheet
+  size_t duplicates; // entries sharing an earlier file's texture
+  size_t hashed; // files read and hashed this session
+  size_t index_hits; // files whose hash came from the index
+  TextureIndex index;
+  const char *index_path; // NULL when there is no index
+  Arena *arena;
+  const Engine *engine;
+} TextureCache;
+
+// Loads the index at `path`, or starts an empty one, and hashes every load
+// from now on
+void textures_open_index(TextureCache *cache, const char *path);
+// Writes the index if it changed; true when there was nothing to write
+bool textures_save_index(TextureCache *cache);
+// Requests `path` unless it, or a file with the same content, already was;
+// `id` is valid while it loads
+bool textures_load(TextureCache *cache, void *manager, const void *event_writer, const char *path, TextureId *id);
+// Requests the sheets of an atlas built by atlas_build and registers each
+// sprite as `atlas dir/name`, sharing its sheet's id and state. Returns how
+// many sprites were registered.
+size_t textures_load_atlas(TextureCache *cache, void *manager, const void *event_writer, const char *path);
+// One path per line, relative to the manifest's directory; blank lines and
+// lines starting with # are skipped, .atlas lines load an atlas. Returns how
+// many paths were requested.
+size_t textures_load_manifest(TextureCache *cache, void *manager, const void *event_writer, const char *manifest);
+// Settles the textures that finished loading or failed; returns how many are
+// still pending
+size_t textures_poll(TextureCache *cache, void *manager);
+// NULL for paths never requested. The pointer is good until the next load.
+const TextureEntry* textures_find(const TextureCache *cache, const char *path);
+void textures_free(TextureCache *cache);
+
+#endif
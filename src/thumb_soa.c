@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <string.h>
+#include <thumb_soa.h>
+#include <fiasco_simd.h>
+
+#define THUMB_SOA_ARRAYS 6
+
+// All arrays live in one block, each padded to a multiple of 8 floats
+bool thumb_soa_reserve(ThumbSoa *soa, size_t len) {
+  soa->len = len;
+  if (len <= soa->cap) return true;
+
+  size_t cap = (len + 7) & ~(size_t)7;
+  float *block = (float*)realloc(soa->h, cap * THUMB_SOA_ARRAYS * sizeof(float));
+  if (block == NULL) {
+    soa->len = 0;
+    return false;
+  }
+
+  float **arrays[THUMB_SOA_ARRAYS] = {&soa->h, &soa->s, &soa->v, &soa->r, &soa->g, &soa->b};
+  for (size_t i = 0; i < THUMB_SOA_ARRAYS; i++) {
+    *arrays[i] = block + i * cap;
+  }
+
+  soa->cap = cap;
+  soa->valid = false;
+  return true;
+}
+
+void thumb_soa_free(ThumbSoa *soa) {
+  free(soa->h);
+  memset(soa, 0, sizeof(ThumbSoa));
+}
+
+Color hue_lut[HUE_LUT_LEN];
+
+void init_hue_lut() {
+  for (int i = 0; i < HUE_LUT_LEN; i++) {
+    hue_lut[i] = hsv_to_rgb((HSVA){(float)i, 1.0f, 1.0f, 1.0f});
+  }
+}
+
+// v - v*s + v*s*lut, the same operations in the same order as color_thumb,
+// so both modes write identical colors
+static void color_scalar(ThumbSoa *soa, size_t begin, float hue_offset) {
+  for (size_t i = begin; i < soa->len; i++) {
+    float h = soa->h[i] + hue_offset;
+    h = h >= HUE_WRAP ? h - HUE_WRAP : h;
+    const Color lut = hue_lut[(int)h];
+    float base = soa->v[i] - soa->v[i] * soa->s[i];
+    float scale = soa->v[i] * soa->s[i];
+    soa->r[i] = base + scale * lut.r;
+    soa->g[i] = base + scale * lut.g;
+    soa->b[i] = base + scale * lut.b;
+  }
+}
+
+#ifdef FIASCO_X86
+
+// SSE2 has no gather, so the table is read a lane at a time
+static size_t color_sse2(ThumbSoa *soa, float hue_offset) {
+  const __m128 offset = _mm_set1_ps(hue_offset);
+  const __m128 hue_wrap = _mm_set1_ps(HUE_WRAP);
+
+  size_t i = 0;
+  for (; i + 4 <= soa->len; i += 4) {
+    __m128 h = _mm_add_ps(_mm_loadu_ps(soa->h + i), offset);
+    h = _mm_sub_ps(h, _mm_and_ps(_mm_cmpge_ps(h, hue_wrap), hue_wrap));
+    int32_t index[4];
+    _mm_storeu_si128((__m128i*)index, _mm_cvttps_epi32(h));
+    const Color *c0 = &hue_lut[index[0]], *c1 = &hue_lut[index[1]];
+    const Color *c2 = &hue_lut[index[2]], *c3 = &hue_lut[index[3]];
+
+    __m128 v = _mm_loadu_ps(soa->v + i);
+    __m128 sv = _mm_mul_ps(v, _mm_loadu_ps(soa->s + i));
+    __m128 base = _mm_sub_ps(v, sv);
+    _mm_storeu_ps(soa->r + i, _mm_add_ps(base, _mm_mul_ps(sv, _mm_setr_ps(c0->r, c1->r, c2->r, c3->r))));
+    _mm_storeu_ps(soa->g + i, _mm_add_ps(base, _mm_mul_ps(sv, _mm_setr_ps(c0->g, c1->g, c2->g, c3->g))));
+    _mm_storeu_ps(soa->b + i, _mm_add_ps(base, _mm_mul_ps(sv, _mm_setr_ps(c0->b, c1->b, c2->b, c3->b))));
+  }
+  return i;
+}
+
+TARGET_AVX2 static size_t color_avx2(ThumbSoa *soa, float hue_offset) {
+  const __m256 offset = _mm256_set1_ps(hue_offset);
+  const __m256 hue_wrap = _mm256_set1_ps(HUE_WRAP);
+  const float *lut = &hue_lut[0].r;
+
+  size_t i = 0;
+  for (; i + 8 <= soa->len; i += 8) {
+    __m256 h = _mm256_add_ps(_mm256_loadu_ps(soa->h + i), offset);
+    h = _mm256_sub_ps(h, _mm256_and_ps(_mm256_cmp_ps(h, hue_wrap, _CMP_GE_OQ), hue_wrap));
+    // a Color is four floats, so channel c of entry n is float 4n + c
+    __m256i index = _mm256_slli_epi32(_mm256_cvttps_epi32(h), 2);
+
+    __m256 v = _mm256_loadu_ps(soa->v + i);
+    __m256 sv = _mm256_mul_ps(v, _mm256_loadu_ps(soa->s + i));
+    __m256 base = _mm256_sub_ps(v, sv);
+    __m256 r = _mm256_i32gather_ps(lut, index, 4);
+    __m256 g = _mm256_i32gather_ps(lut + 1, index, 4);
+    __m256 b = _mm256_i32gather_ps(lut + 2, index, 4);
+    _mm256_storeu_ps(soa->r + i, _mm256_add_ps(base, _mm256_mul_ps(sv, r)));
+    _mm256_storeu_ps(soa->g + i, _mm256_add_ps(base, _mm256_mul_ps(sv, g)));
+    _mm256_storeu_ps(soa->b + i, _mm256_add_ps(base, _mm256_mul_ps(sv, b)));
+  }
+  return i;
+}
+
+#endif
+
+// Hue is the stored phase plus `hue_offset`, wrapped at HUE_WRAP
+void thumb_soa_color(ThumbSoa *soa, float hue_offset) {
+  size_t done = 0;
+
+#ifdef FIASCO_X86
+  SimdLevel level = simd_level();
+  if (level == SimdAvx2) {
+    done = color_avx2(soa, hue_offset);
+  } else if (level == SimdSse2) {
+    done = color_sse2(soa, hue_offset);
+  }
+#endif
+
+  color_scalar(soa, done, hue_offset);
+}
+
+// MOTION
+
+#define THUMB_MOTION_ARRAYS 6
+
+bool thumb_motion_reserve(ThumbMotion *motion, size_t len) {
+  motion->len = len;
+  if (len <= motion->cap) return true;
+
+  size_t cap = (len + 7) & ~(size_t)7;
+  float *block = (float*)realloc(motion->x, cap * THUMB_MOTION_ARRAYS * sizeof(float));
+  if (block == NULL) {
+    motion->len = 0;
+    return false;
+  }
+
+  float **arrays[THUMB_MOTION_ARRAYS] = {
+    &motion->x, &motion->y, &motion->rotation, &motion->dir_x, &motion->dir_y, &motion->speed
+  };
+  for (size_t i = 0; i < THUMB_MOTION_ARRAYS; i++) {
+    *arrays[i] = block + i * cap;
+  }
+
+  motion->cap = cap;
+  motion->valid = false;
+  return true;
+}
+
+void thumb_motion_free(ThumbMotion *motion) {
+  free(motion->x);
+  memset(motion, 0, sizeof(ThumbMotion));
+}
+
+static void motion_scalar(ThumbMotion *motion, size_t begin, float delta, Screen screen) {
+  for (size_t i = begin; i < motion->len; i++) {
+    float step = delta * motion->speed[i];
+    float x = motion->x[i] + motion->dir_x[i] * step;
+    float y = motion->y[i] + motion->dir_y[i] * step;
+    motion->rotation[i] -= delta * 2;
+    x = x > screen.right ? screen.right : x < screen.left ? screen.left : x;
+    y = y > screen.top ? screen.top : y < screen.bottom ? screen.bottom : y;
+    motion->x[i] = x;
+    motion->y[i] = y;
+
+    // same test as bounce_thumb
+    float dir_x = motion->dir_x[i];
+    float dir_y = motion->dir_y[i];
+    if ((x >= screen.right && dir_x > 0) || (x <= screen.left && dir_x < 0)) motion->dir_x[i] = -dir_x;
+    if ((y >= screen.top && dir_y > 0) || (y <= screen.bottom && dir_y < 0)) motion->dir_y[i] = -dir_y;
+  }
+}
+
+#ifdef FIASCO_X86
+
+static size_t motion_sse2(ThumbMotion *motion, float delta, Screen screen) {
+  const __m128 vdelta = _mm_set1_ps(delta);
+  const __m128 spin = _mm_set1_ps(delta * 2);
+  const __m128 right = _mm_set1_ps(screen.right);
+  const __m128 left = _mm_set1_ps(screen.left);
+  const __m128 top = _mm_set1_ps(screen.top);
+  const __m128 bottom = _mm_set1_ps(screen.bottom);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 sign = _mm_set1_ps(-0.0f);
+
+  size_t i = 0;
+  for (; i + 4 <= motion->len; i += 4) {
+    __m128 step = _mm_mul_ps(vdelta, _mm_loadu_ps(motion->speed + i));
+    __m128 dir_x = _mm_loadu_ps(motion->dir_x + i);
+    __m128 dir_y = _mm_loadu_ps(motion->dir_y + i);
+    __m128 x = _mm_add_ps(_mm_loadu_ps(motion->x + i), _mm_mul_ps(dir_x, step));
+    __m128 y = _mm_add_ps(_mm_loadu_ps(motion->y + i), _mm_mul_ps(dir_y, step));
+    x = _mm_min_ps(_mm_max_ps(x, left), right);
+    y = _mm_min_ps(_mm_max_ps(y, bottom), top);
+    _mm_storeu_ps(motion->x + i, x);
+    _mm_storeu_ps(motion->y + i, y);
+    _mm_storeu_ps(motion->rotation + i, _mm_sub_ps(_mm_loadu_ps(motion->rotation + i), spin));
+
+    // flipping the sign bit is the scalar path's negation
+    __m128 out_x = _mm_or_ps(_mm_and_ps(_mm_cmpge_ps(x, right), _mm_cmpgt_ps(dir_x, zero)),
+                             _mm_and_ps(_mm_cmple_ps(x, left), _mm_cmplt_ps(dir_x, zero)));
+    __m128 out_y = _mm_or_ps(_mm_and_ps(_mm_cmpge_ps(y, top), _mm_cmpgt_ps(dir_y, zero)),
+                             _mm_and_ps(_mm_cmple_ps(y, bottom), _mm_cmplt_ps(dir_y, zero)));
+    _mm_storeu_ps(motion->dir_x + i, _mm_xor_ps(dir_x, _mm_and_ps(out_x, sign)));
+    _mm_storeu_ps(motion->dir_y + i, _mm_xor_ps(dir_y, _mm_and_ps(out_y, sign)));
+  }
+  return i;
+}
+
+TARGET_AVX2 static size_t motion_avx2(ThumbMotion *motion, float delta, Screen screen) {
+  const __m256 vdelta = _mm256_set1_ps(delta);
+  const __m256 spin = _mm256_set1_ps(delta * 2);
+  const __m256 right = _mm256_set1_ps(screen.right);
+  const __m256 left = _mm256_set1_ps(screen.left);
+  const __m256 top = _mm256_set1_ps(screen.top);
+  const __m256 bottom = _mm256_set1_ps(screen.bottom);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+
+  size_t i = 0;
+  for (; i + 8 <= motion->len; i += 8) {
+    __m256 step = _mm256_mul_ps(vdelta, _mm256_loadu_ps(motion->speed + i));
+    __m256 dir_x = _mm256_loadu_ps(motion->dir_x + i);
+    __m256 dir_y = _mm256_loadu_ps(motion->dir_y + i);
+    __m256 x = _mm256_add_ps(_mm256_loadu_ps(motion->x + i), _mm256_mul_ps(dir_x, step));
+    __m256 y = _mm256_add_ps(_mm256_loadu_ps(motion->y + i), _mm256_mul_ps(dir_y, step));
+    x = _mm256_min_ps(_mm256_max_ps(x, left), right);
+    y = _mm256_min_ps(_mm256_max_ps(y, bottom), top);
+    _mm256_storeu_ps(motion->x + i, x);
+    _mm256_storeu_ps(motion->y + i, y);
+    _mm256_storeu_ps(motion->rotation + i, _mm256_sub_ps(_mm256_loadu_ps(motion->rotation + i), spin));
+
+    __m256 out_x = _mm256_or_ps(
+      _mm256_and_ps(_mm256_cmp_ps(x, right, _CMP_GE_OQ), _mm256_cmp_ps(dir_x, zero, _CMP_GT_OQ)),
+      _mm256_and_ps(_mm256_cmp_ps(x, left, _CMP_LE_OQ), _mm256_cmp_ps(dir_x, zero, _CMP_LT_OQ)));
+    __m256 out_y = _mm256_or_ps(
+      _mm256_and_ps(_mm256_cmp_ps(y, top, _CMP_GE_OQ), _mm256_cmp_ps(dir_y, zero, _CMP_GT_OQ)),
+      _mm256_and_ps(_mm256_cmp_ps(y, bottom, _CMP_LE_OQ), _mm256_cmp_ps(dir_y, zero, _CMP_LT_OQ)));
+    _mm256_storeu_ps(motion->dir_x + i, _mm256_xor_ps(dir_x, _mm256_and_ps(out_x, sign)));
+    _mm256_storeu_ps(motion->dir_y + i, _mm256_xor_ps(dir_y, _mm256_and_ps(out_y, sign)));
+  }
+  return i;
+}
+
+#endif
+
+void thumb_motion_step(ThumbMotion *motion, float delta, Screen screen) {
+  size_t done = 0;
+
+#ifdef FIASCO_X86
+  SimdLevel level = simd_level();
+  if (level == SimdAvx2) {
+    done = motion_avx2(motion, delta, screen);
+  } else if (level == SimdSse2) {
+    done = motion_sse2(motion, delta, screen);
+  }
+#endif
+
+  motion_scalar(motion, done, delta, screen);
+}
@@ -0,0 +1,58 @@
+#ifndef THUMB_SOA_H
+#define THUMB_SOA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <fiasco.h>
+
+#define HUE_LUT_LEN 360
+// Hues run over [0, HUE_WRAP) and wrap there
+#define HUE_WRAP 355
+
+// Fully saturated rgb for each whole degree of hue, filled by init_hue_lut.
+// Both color paths read it, so they agree to the bit.
+extern Color hue_lut[HUE_LUT_LEN];
+void init_hue_lut();
+
+// Structure-of-arrays shadow of the thumb state `thumb_color` needs: hue
+// phase, saturation and value in, rgb out.
+typedef struct {
+  size_t len;
+  size_t cap;
+  bool valid;
+  float *h;
+  float *s;
+  float *v;
+  float *r;
+  float *g;
+  float *b;
+} ThumbSoa;
+
+bool thumb_soa_reserve(ThumbSoa *soa, size_t len);
+void thumb_soa_free(ThumbSoa *soa);
+void thumb_soa_color(ThumbSoa *soa, float hue_offset);
+
+// Structure-of-arrays copy of what `thumb_movement` reads and writes. It is
+// its own block because thumb_movement and thumb_color may run at once.
+// Headings are unit vectors, so the step needs no trig. It stays valid
+// across frames like ThumbSoa; only the collider, spawns, pooling and
+// restores change these fields behind its back.
+typedef struct {
+  size_t len;
+  size_t cap;
+  bool valid;
+  float *x;
+  float *y;
+  float *rotation;
+  float *dir_x;
+  float *dir_y;
+  float *speed;
+} ThumbMotion;
+
+bool thumb_motion_reserve(ThumbMotion *motion, size_t len);
+void thumb_motion_free(ThumbMotion *motion);
+// Moves every thumb along its heading and stops it at the screen edge, then
+// turns the copy's heading exactly as thumb_bounce turns the Thumb
+void thumb_motion_step(ThumbMotion *motion, float delta, Screen screen);
+
+#endif